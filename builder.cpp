@@ -0,0 +1,125 @@
+#include "builder.hpp"
+
+using namespace cocaine;
+
+dynamic_builder_t::dynamic_builder_t(dynamic_t& root) :
+    m_root(root),
+    m_done(false)
+{
+    // pass
+}
+
+template<class T>
+dynamic_t&
+dynamic_builder_t::emplace(T&& value) {
+    if (m_stack.empty()) {
+        m_root = std::forward<T>(value);
+        return m_root;
+    }
+
+    const frame_t& top = m_stack.back();
+
+    if (top.array) {
+        top.array->emplace_back(std::forward<T>(value));
+        return top.array->back();
+    }
+
+    dynamic_t::object_t& object = *top.object;
+
+    if (object.empty() || object.rbegin()->first < m_key) {
+        return object.emplace_hint(
+            object.end(),
+            std::piecewise_construct,
+            std::forward_as_tuple(std::move(m_key)),
+            std::forward_as_tuple(std::forward<T>(value))
+        )->second;
+    }
+
+    // Keys out of order or duplicates.
+    dynamic_t& member = object[m_key];
+    member = std::forward<T>(value);
+    return member;
+}
+
+void
+dynamic_builder_t::close() {
+    if (m_stack.empty()) {
+        m_done = true;
+    }
+}
+
+void
+dynamic_builder_t::null_value() {
+    emplace(dynamic_t::null_t());
+    close();
+}
+
+void
+dynamic_builder_t::bool_value(dynamic_t::bool_t v) {
+    emplace(v);
+    close();
+}
+
+void
+dynamic_builder_t::int_value(dynamic_t::int_t v) {
+    emplace(v);
+    close();
+}
+
+void
+dynamic_builder_t::double_value(dynamic_t::double_t v) {
+    emplace(v);
+    close();
+}
+
+void
+dynamic_builder_t::string_value(const char *data, size_t size) {
+    emplace(dynamic_t::string_view_t(data, size));
+    close();
+}
+
+void
+dynamic_builder_t::string_value(std::string&& v) {
+    emplace(std::move(v));
+    close();
+}
+
+void
+dynamic_builder_t::begin_array(size_t size) {
+    dynamic_t::array_t& array = emplace(dynamic_t::array_t()).as_array();
+
+    if (size != events::unknown_size) {
+        array.reserve(size);
+    }
+
+    frame_t frame = { &array, nullptr };
+    m_stack.push_back(frame);
+}
+
+void
+dynamic_builder_t::end_array() {
+    m_stack.pop_back();
+    close();
+}
+
+void
+dynamic_builder_t::begin_object(size_t) {
+    frame_t frame = { nullptr, &emplace(dynamic_t::object_t()).as_object() };
+    m_stack.push_back(frame);
+}
+
+void
+dynamic_builder_t::key(const char *data, size_t size) {
+    m_key.assign(data, size);
+}
+
+void
+dynamic_builder_t::end_object() {
+    m_stack.pop_back();
+    close();
+}
+
+bool
+dynamic_builder_t::done() const {
+    return m_done;
+}
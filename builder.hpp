@@ -0,0 +1,87 @@
+#ifndef COCAINE_DYNAMIC_BUILDER_HPP
+#define COCAINE_DYNAMIC_BUILDER_HPP
+
+#include "dynamic.hpp"
+#include "events.hpp"
+
+#include <string>
+#include <vector>
+
+namespace cocaine {
+
+// Event handler (see events.hpp) which builds the document right in the target node.
+// Every value is constructed in place in its final position: elements are emplaced into arrays reserved
+// according to the size hints, members are emplaced at the end of objects when keys arrive in order,
+// as they do from emit() and the compact encoding. There are no temporary containers moved into their parents
+// and no recursion, the only state is a stack of open containers.
+//
+// Size hints are trusted, producers reading untrusted input should clamp them, like the compact decoder does.
+// Duplicate keys keep the last value. The events must form a single well-formed document.
+class dynamic_builder_t {
+public:
+    explicit
+    dynamic_builder_t(dynamic_t& root);
+
+    void
+    null_value();
+
+    void
+    bool_value(dynamic_t::bool_t v);
+
+    void
+    int_value(dynamic_t::int_t v);
+
+    void
+    double_value(dynamic_t::double_t v);
+
+    void
+    string_value(const char *data, size_t size);
+
+    // Moves the string into the document.
+    void
+    string_value(std::string&& v);
+
+    void
+    begin_array(size_t size);
+
+    void
+    end_array();
+
+    void
+    begin_object(size_t size);
+
+    void
+    key(const char *data, size_t size);
+
+    void
+    end_object();
+
+    // Whether the whole document has been built.
+    bool
+    done() const;
+
+private:
+    // Constructs the next value in its place and returns it.
+    template<class T>
+    dynamic_t&
+    emplace(T&& value);
+
+    void
+    close();
+
+private:
+    // Exactly one of the pointers is set.
+    struct frame_t {
+        dynamic_t::array_t *array;
+        dynamic_t::object_t *object;
+    };
+
+    dynamic_t& m_root;
+    std::vector<frame_t> m_stack;
+    std::string m_key;
+    bool m_done;
+};
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_BUILDER_HPP
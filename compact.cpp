@@ -0,0 +1,416 @@
+#include "compact.hpp"
+
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+using namespace cocaine;
+using namespace cocaine::io;
+
+namespace {
+
+enum tag_t {
+    null_tag,
+    false_tag,
+    true_tag,
+    int_tag,
+    double_tag,
+    string_tag,
+    array_tag,
+    object_tag
+};
+
+// Keys of the dictionary point into the document being encoded, so they are never copied.
+struct key_hash_t {
+    size_t
+    operator()(const std::string *key) const {
+        return std::hash<std::string>()(*key);
+    }
+};
+
+struct key_equal_t {
+    bool
+    operator()(const std::string *lhs, const std::string *rhs) const {
+        return *lhs == *rhs;
+    }
+};
+
+class encoder_t :
+    public boost::static_visitor<>
+{
+public:
+    encoder_t(std::string& output) :
+        m_output(output),
+        m_depth(0)
+    {
+        // pass
+    }
+
+    void
+    operator()(const dynamic_t::null_t&) {
+        m_output.push_back(null_tag);
+    }
+
+    void
+    operator()(const dynamic_t::bool_t& v) {
+        m_output.push_back(v ? true_tag : false_tag);
+    }
+
+    void
+    operator()(const dynamic_t::int_t& v) {
+        m_output.push_back(int_tag);
+
+        // Zigzag encoding keeps small negative numbers short.
+        write_varint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+    }
+
+    void
+    operator()(const dynamic_t::double_t& v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+
+        char buffer[9] = { double_tag };
+
+        for (size_t i = 0; i < 8; ++i) {
+            buffer[i + 1] = static_cast<char>(bits >> (8 * i));
+        }
+
+        m_output.append(buffer, sizeof(buffer));
+    }
+
+    void
+    operator()(const dynamic_t::string_t& v) {
+        m_output.push_back(string_tag);
+        write_string(v);
+    }
+
+    void
+    operator()(const dynamic_t::array_t& v) {
+        m_output.push_back(array_tag);
+        write_varint(v.size());
+
+        ++m_depth;
+
+        for (auto it = v.begin(); it != v.end(); ++it) {
+            it->apply(*this);
+        }
+
+        --m_depth;
+    }
+
+    void
+    operator()(const dynamic_t::object_t& v) {
+        m_output.push_back(object_tag);
+        write_varint(v.size());
+
+        if (m_shapes.size() <= m_depth) {
+            m_shapes.resize(m_depth + 1);
+        }
+
+        ++m_depth;
+
+        size_t index = 0;
+
+        for (auto it = v.begin(); it != v.end(); ++it, ++index) {
+            write_key(it->first, index);
+            it->second.apply(*this);
+        }
+
+        --m_depth;
+    }
+
+private:
+    // Writes either the id of a known key or the key itself, assigning it the next id.
+    void
+    write_key(const std::string& key, size_t index) {
+        // Objects at the same depth usually share the shape (think of arrays of records),
+        // so the key at the same position of the previous object is checked before the dictionary.
+        shape_t& shape = m_shapes[m_depth - 1];
+
+        if (index < shape.size() && *shape[index].first == key) {
+            write_varint(shape[index].second);
+            return;
+        }
+
+        auto it = m_keys.insert(std::make_pair(&key, m_keys.size() + 1));
+
+        if (it.second) {
+            // Zero introduces a new key.
+            write_varint(0);
+            write_string(key);
+        } else {
+            write_varint(it.first->second);
+        }
+
+        if (index < shape.size()) {
+            shape[index] = *it.first;
+        } else {
+            shape.push_back(*it.first);
+        }
+    }
+
+    void
+    write_varint(uint64_t v) {
+        char buffer[10];
+        size_t size = 0;
+
+        while (v >= 0x80) {
+            buffer[size++] = static_cast<char>(v | 0x80);
+            v >>= 7;
+        }
+
+        buffer[size++] = static_cast<char>(v);
+        m_output.append(buffer, size);
+    }
+
+    void
+    write_string(const std::string& v) {
+        write_varint(v.size());
+        m_output.append(v);
+    }
+
+private:
+    std::string& m_output;
+    std::unordered_map<const std::string*, uint64_t, key_hash_t, key_equal_t> m_keys;
+
+    // Keys of the last object encoded at each depth along with their ids.
+    typedef std::vector<std::pair<const std::string*, uint64_t>> shape_t;
+
+    std::vector<shape_t> m_shapes;
+    size_t m_depth;
+};
+
+class decoder_t {
+public:
+    decoder_t(const char *data, size_t size, deduplicator_t *deduplicator) :
+        m_data(data),
+        m_end(data + size),
+        m_deduplicator(deduplicator),
+        m_depth(0)
+    {
+        // pass
+    }
+
+    void
+    decode(dynamic_t& target) {
+        switch (read_byte()) {
+        case null_tag:
+            target = dynamic_t::null_t();
+            break;
+
+        case false_tag:
+            target = false;
+            break;
+
+        case true_tag:
+            target = true;
+            break;
+
+        case int_tag: {
+            const uint64_t v = read_varint();
+            target = static_cast<dynamic_t::int_t>((v >> 1) ^ (~(v & 1) + 1));
+        } break;
+
+        case double_tag: {
+            const unsigned char *bytes = reinterpret_cast<const unsigned char*>(read(8));
+            uint64_t bits = 0;
+
+            for (size_t i = 0; i < 8; ++i) {
+                bits |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+            }
+
+            dynamic_t::double_t v;
+            std::memcpy(&v, &bits, sizeof(v));
+            target = v;
+        } break;
+
+        case string_tag: {
+            const uint64_t size = read_varint();
+            target = std::string(read(size), size);
+        } break;
+
+        case array_tag: {
+            const uint64_t size = read_varint();
+
+            dynamic_t::array_t& array = (target = dynamic_t::array_t()).as_array();
+
+            // Every element takes at least one byte, so malformed sizes can't trigger huge allocations.
+            array.reserve(std::min<uint64_t>(size, m_end - m_data));
+
+            enter();
+
+            for (uint64_t i = 0; i < size; ++i) {
+                array.emplace_back();
+                decode(array.back());
+                intern(array.back());
+            }
+
+            --m_depth;
+        } break;
+
+        case object_tag: {
+            const uint64_t size = read_varint();
+
+            dynamic_t::object_t& object = (target = dynamic_t::object_t()).as_object();
+
+            enter();
+
+            for (uint64_t i = 0; i < size; ++i) {
+                const std::string& key = read_key();
+
+                // Keys are written in the sorted order of object_t, so the hint is always right. Anything else
+                // is malformed: a repeated key would overwrite a member the deduplicator already refers to.
+                if (!object.empty() && !(object.rbegin()->first < key)) {
+                    throw compact_error("object keys are not sorted or not unique");
+                }
+
+                auto it = object.emplace_hint(object.end(), key, dynamic_t());
+                decode(it->second);
+                intern(it->second);
+            }
+
+            --m_depth;
+        } break;
+
+        default:
+            throw compact_error("unknown tag");
+        }
+    }
+
+    bool
+    empty() const {
+        return m_data == m_end;
+    }
+
+private:
+    void
+    enter() {
+        if (m_depth == compact_max_depth) {
+            throw compact_error("document is nested too deeply");
+        }
+
+        ++m_depth;
+    }
+
+    // Top-level elements are deduplicated as soon as they are decoded, so at most one of them
+    // is held in memory in full. Arrays are reserved up front and object members live in tree nodes,
+    // so the elements stay in place until the end as the deduplicator requires.
+    void
+    intern(dynamic_t& node) {
+        if (m_deduplicator && m_depth == 1) {
+            m_deduplicator->add(node);
+        }
+    }
+
+    const std::string&
+    read_key() {
+        const uint64_t id = read_varint();
+
+        if (id == 0) {
+            const uint64_t size = read_varint();
+            m_keys.push_back(std::string(read(size), size));
+            return m_keys.back();
+        }
+
+        if (id > m_keys.size()) {
+            throw compact_error("unknown key id");
+        }
+
+        return m_keys[id - 1];
+    }
+
+    uint64_t
+    read_varint() {
+        uint64_t result = 0;
+
+        for (size_t shift = 0; shift < 64; shift += 7) {
+            const unsigned char byte = read_byte();
+            result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+            if (byte < 0x80) {
+                return result;
+            }
+        }
+
+        throw compact_error("varint is too long");
+    }
+
+    unsigned char
+    read_byte() {
+        return *read(1);
+    }
+
+    const char*
+    read(uint64_t size) {
+        if (static_cast<uint64_t>(m_end - m_data) < size) {
+            throw compact_error("insufficient bytes");
+        }
+
+        const char *result = m_data;
+        m_data += size;
+        return result;
+    }
+
+private:
+    const char *m_data;
+    const char *const m_end;
+
+    deduplicator_t *const m_deduplicator;
+    size_t m_depth;
+
+    std::vector<std::string> m_keys;
+};
+
+} // namespace
+
+void
+io::compact_encode(const dynamic_t& source, std::string& output) {
+    encoder_t encoder(output);
+    source.apply(encoder);
+}
+
+std::string
+io::compact_encode(const dynamic_t& source) {
+    std::string result;
+    compact_encode(source, result);
+    return result;
+}
+
+dynamic_t
+io::compact_decode(const char *data, size_t size) {
+    dynamic_t result;
+    decoder_t decoder(data, size, nullptr);
+    decoder.decode(result);
+
+    if (!decoder.empty()) {
+        throw compact_error("trailing bytes");
+    }
+
+    return result;
+}
+
+dynamic_t
+io::compact_decode(const char *data, size_t size, deduplicator_t& deduplicator) {
+    dynamic_t result;
+    decoder_t decoder(data, size, &deduplicator);
+
+    try {
+        decoder.decode(result);
+    } catch (...) {
+        deduplicator.finish();
+        throw;
+    }
+
+    deduplicator.finish();
+
+    if (!decoder.empty()) {
+        throw compact_error("trailing bytes");
+    }
+
+    return result;
+}
+
+dynamic_t
+io::compact_decode(const std::string& data) {
+    return compact_decode(data.data(), data.size());
+}
@@ -0,0 +1,56 @@
+#ifndef COCAINE_DYNAMIC_COMPACT_HPP
+#define COCAINE_DYNAMIC_COMPACT_HPP
+
+#include "dynamic.hpp"
+#include "dedup.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace cocaine { namespace io {
+
+// Compact binary encoding of dynamic_t.
+//
+// Every value starts with a tag byte. Integers are zigzag varints, doubles are 8 little-endian bytes,
+// strings and containers are prefixed with their varint size. Object keys are stored in a dictionary
+// which is built on the fly: the first occurrence of a key is written inline and assigned the next id,
+// later occurrences refer to it by the varint id. Arrays of same-shaped objects therefore pay for
+// their keys only once.
+
+struct compact_error :
+    public std::runtime_error
+{
+    compact_error(const std::string& message) :
+        std::runtime_error(message)
+    {
+        // pass
+    }
+};
+
+// Decoding is recursive, so deeper documents are rejected instead of overflowing the stack.
+const size_t compact_max_depth = 512;
+
+// Appends the encoded document to the output.
+void
+compact_encode(const dynamic_t& source, std::string& output);
+
+std::string
+compact_encode(const dynamic_t& source);
+
+// Decodes a single document. Throws compact_error if the data is malformed
+// or containers are nested deeper than compact_max_depth.
+dynamic_t
+compact_decode(const char *data, size_t size);
+
+dynamic_t
+compact_decode(const std::string& data);
+
+// Decodes a document sharing identical subtrees through the deduplicator as it goes,
+// so repetitive documents never take their full size in memory. Subtrees shared by previous documents
+// decoded with the same deduplicator are reused too.
+dynamic_t
+compact_decode(const char *data, size_t size, deduplicator_t& deduplicator);
+
+}} // namespace cocaine::io
+
+#endif // COCAINE_DYNAMIC_COMPACT_HPP
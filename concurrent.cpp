@@ -0,0 +1,178 @@
+#include "concurrent.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+using namespace cocaine;
+
+namespace {
+
+typedef concurrent_builder_t::shard_t::member_type member_type;
+
+bool
+key_less(const member_type& lhs, const member_type& rhs) {
+    return lhs.first < rhs.first;
+}
+
+} // namespace
+
+concurrent_builder_t::concurrent_builder_t() {
+    // pass
+}
+
+concurrent_builder_t::shard_t&
+concurrent_builder_t::acquire() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_shards.emplace_back(new shard_t());
+    return *m_shards.back();
+}
+
+dynamic_t
+concurrent_builder_t::build(thread_pool_t& pool) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    bool members = false;
+    bool elements = false;
+
+    for (auto it = m_shards.begin(); it != m_shards.end(); ++it) {
+        members = members || !(*it)->m_members.empty();
+        elements = elements || !(*it)->m_elements.empty();
+    }
+
+    if (members && elements) {
+        throw std::logic_error("both members and elements were added to the concurrent builder");
+    }
+
+    return members ? build_object(pool) : build_array(pool);
+}
+
+dynamic_t
+concurrent_builder_t::build_object(thread_pool_t& pool) {
+    std::vector<std::vector<member_type>> runs;
+
+    for (auto it = m_shards.begin(); it != m_shards.end(); ++it) {
+        if (!(*it)->m_members.empty()) {
+            runs.push_back(std::move((*it)->m_members));
+            (*it)->m_members.clear();
+        }
+    }
+
+    // Both the sort and the merges are stable, so duplicate keys stay in the order of insertion.
+    {
+        task_group_t group(pool);
+
+        try {
+            for (auto it = runs.begin(); it != runs.end(); ++it) {
+                std::vector<member_type> *run = &*it;
+
+                group.spawn([run]() {
+                    std::stable_sort(run->begin(), run->end(), &key_less);
+                });
+            }
+        } catch (...) {
+            group.wait();
+            throw;
+        }
+
+        group.wait();
+    }
+
+    while (runs.size() > 1) {
+        std::vector<std::vector<member_type>> merged(runs.size() / 2);
+
+        {
+            task_group_t group(pool);
+
+            try {
+                for (size_t i = 0; i < merged.size(); ++i) {
+                    std::vector<member_type> *first = &runs[2 * i];
+                    std::vector<member_type> *second = &runs[2 * i + 1];
+                    std::vector<member_type> *output = &merged[i];
+
+                    group.spawn([first, second, output]() {
+                        output->reserve(first->size() + second->size());
+
+                        std::merge(std::make_move_iterator(first->begin()),
+                                   std::make_move_iterator(first->end()),
+                                   std::make_move_iterator(second->begin()),
+                                   std::make_move_iterator(second->end()),
+                                   std::back_inserter(*output),
+                                   &key_less);
+
+                        std::vector<member_type>().swap(*first);
+                        std::vector<member_type>().swap(*second);
+                    });
+                }
+            } catch (...) {
+                group.wait();
+                throw;
+            }
+
+            group.wait();
+        }
+
+        if (runs.size() % 2 != 0) {
+            merged.push_back(std::move(runs.back()));
+        }
+
+        runs.swap(merged);
+    }
+
+    dynamic_t result = dynamic_t::object_t();
+    dynamic_t::object_t& object = result.as_object();
+
+    if (!runs.empty()) {
+        std::vector<member_type>& members = runs.front();
+
+        for (auto it = members.begin(); it != members.end(); ++it) {
+            if (!object.empty() && object.rbegin()->first == it->first) {
+                object.rbegin()->second = std::move(it->second);
+            } else {
+                object.emplace_hint(object.end(), std::move(it->first), std::move(it->second));
+            }
+        }
+    }
+
+    return result;
+}
+
+dynamic_t
+concurrent_builder_t::build_array(thread_pool_t& pool) {
+    size_t size = 0;
+
+    for (auto it = m_shards.begin(); it != m_shards.end(); ++it) {
+        size += (*it)->m_elements.size();
+    }
+
+    dynamic_t result = dynamic_t::array_t(size);
+    dynamic_t *output = result.as_array().data();
+
+    task_group_t group(pool);
+
+    try {
+        for (auto it = m_shards.begin(); it != m_shards.end(); ++it) {
+            std::vector<dynamic_t> *elements = &(*it)->m_elements;
+            const size_t count = elements->size();
+
+            if (count == 0) {
+                continue;
+            }
+
+            // The task empties the shard, so the size is taken before it is spawned.
+            group.spawn([elements, output]() {
+                std::move(elements->begin(), elements->end(), output);
+                std::vector<dynamic_t>().swap(*elements);
+            });
+
+            output += count;
+        }
+    } catch (...) {
+        group.wait();
+        throw;
+    }
+
+    group.wait();
+    return result;
+}
@@ -0,0 +1,87 @@
+#ifndef COCAINE_DYNAMIC_CONCURRENT_HPP
+#define COCAINE_DYNAMIC_CONCURRENT_HPP
+
+#include "dynamic.hpp"
+#include "parallel.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cocaine {
+
+// Assembles one large object or array from several producer threads without a lock around every insertion.
+// Every producer acquires its own shard once and appends to it, shards are merged into a single document at the end:
+//
+//     concurrent_builder_t builder;
+//
+//     // In every producer thread.
+//     concurrent_builder_t::shard_t& shard = builder.acquire();
+//     shard.insert(key, value);
+//
+//     // When all producers are done.
+//     dynamic_t result = builder.build(pool);
+//
+// The result is an object if members were inserted and an array of the elements otherwise.
+// Elements come in the order in which the shards were acquired, each shard keeps the order of its own elements.
+// Of duplicate keys the member inserted last into the shard acquired last wins.
+class concurrent_builder_t {
+public:
+    class shard_t {
+    public:
+        typedef std::pair<std::string, dynamic_t> member_type;
+
+    public:
+        void
+        insert(std::string key, dynamic_t value) {
+            m_members.emplace_back(std::move(key), std::move(value));
+        }
+
+        void
+        push_back(dynamic_t value) {
+            m_elements.push_back(std::move(value));
+        }
+
+    private:
+        friend class concurrent_builder_t;
+
+        std::vector<member_type> m_members;
+        std::vector<dynamic_t> m_elements;
+    };
+
+public:
+    concurrent_builder_t();
+
+    // Returns a new shard, which must be used by one thread at a time. Only this call takes the lock.
+    shard_t&
+    acquire();
+
+    // Merges the shards into a document and empties them. Shards are sorted and merged pairwise by tasks
+    // in the pool, then the object is filled in key order with no searches. Array elements are moved into
+    // their final positions in parallel. Throws std::logic_error if both members and elements were added.
+    // Must not be called while producers still write into the shards.
+    dynamic_t
+    build(thread_pool_t& pool);
+
+private:
+    concurrent_builder_t(const concurrent_builder_t&);
+
+    concurrent_builder_t&
+    operator=(const concurrent_builder_t&);
+
+    dynamic_t
+    build_object(thread_pool_t& pool);
+
+    dynamic_t
+    build_array(thread_pool_t& pool);
+
+private:
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<shard_t>> m_shards;
+};
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_CONCURRENT_HPP
@@ -101,6 +101,19 @@ struct dynamic_constructor<std::string, void> {
     }
 };
 
+template<>
+struct dynamic_constructor<dynamic_t::string_view_t, void> {
+    static const bool enable = true;
+
+    static
+    inline
+    void
+    convert(const dynamic_t::string_view_t& from, dynamic_t::value_t& to) {
+        to = dynamic_t::string_t();
+        boost::get<dynamic_t::string_t>(to).assign(from.data(), from.size());
+    }
+};
+
 template<>
 struct dynamic_constructor<std::vector<dynamic_t>, void> {
     static const bool enable = true;
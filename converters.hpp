@@ -8,6 +8,35 @@
 
 namespace cocaine {
 
+namespace detail { namespace dynamic {
+
+    template<class Converter, class>
+    struct try_converter {
+        static
+        boost::optional<typename Converter::result_type>
+        convert(const cocaine::dynamic_t& from) {
+            if (Converter::convertible(from)) {
+                return boost::optional<typename Converter::result_type>(Converter::convert(from));
+            } else {
+                return boost::none;
+            }
+        }
+    };
+
+    template<class Converter>
+    struct try_converter<
+        Converter,
+        typename always_void<decltype(Converter::try_convert(std::declval<const cocaine::dynamic_t&>()))>::type
+    > {
+        static
+        boost::optional<typename Converter::result_type>
+        convert(const cocaine::dynamic_t& from) {
+            return Converter::try_convert(from);
+        }
+    };
+
+}} // namespace detail::dynamic
+
 template<>
 struct dynamic_converter<dynamic_t, void> {
     typedef const dynamic_t& result_type;
@@ -23,6 +52,12 @@ struct dynamic_converter<dynamic_t, void> {
     convertible(const dynamic_t&) {
         return true;
     }
+
+    static
+    boost::optional<result_type>
+    try_convert(const dynamic_t& from) {
+        return boost::optional<result_type>(from);
+    }
 };
 
 template<>
@@ -40,6 +75,16 @@ struct dynamic_converter<bool, void> {
     convertible(const dynamic_t& from) {
         return from.is_bool();
     }
+
+    static
+    boost::optional<result_type>
+    try_convert(const dynamic_t& from) {
+        if (from.is_bool()) {
+            return boost::optional<result_type>(from.as_bool());
+        } else {
+            return boost::none;
+        }
+    }
 };
 
 template<class To>
@@ -61,6 +106,18 @@ struct dynamic_converter<To, typename std::enable_if<std::is_arithmetic<To>::val
     convertible(const dynamic_t& from) {
         return from.is_int() || from.is_double();
     }
+
+    static
+    boost::optional<result_type>
+    try_convert(const dynamic_t& from) {
+        if (from.is_int()) {
+            return boost::optional<result_type>(from.as_int());
+        } else if (from.is_double()) {
+            return boost::optional<result_type>(from.as_double());
+        } else {
+            return boost::none;
+        }
+    }
 };
 
 template<class To>
@@ -78,6 +135,16 @@ struct dynamic_converter<To, typename std::enable_if<std::is_enum<To>::value>::t
     convertible(const dynamic_t& from) {
         return from.is_int();
     }
+
+    static
+    boost::optional<result_type>
+    try_convert(const dynamic_t& from) {
+        if (from.is_int()) {
+            return boost::optional<result_type>(static_cast<result_type>(from.as_int()));
+        } else {
+            return boost::none;
+        }
+    }
 };
 
 template<>
@@ -95,6 +162,16 @@ struct dynamic_converter<std::string, void> {
     convertible(const dynamic_t& from) {
         return from.is_string();
     }
+
+    static
+    boost::optional<result_type>
+    try_convert(const dynamic_t& from) {
+        if (from.is_string()) {
+            return boost::optional<result_type>(from.as_string());
+        } else {
+            return boost::none;
+        }
+    }
 };
 
 template<>
@@ -112,6 +189,43 @@ struct dynamic_converter<const char*, void> {
     convertible(const dynamic_t& from) {
         return from.is_string();
     }
+
+    static
+    boost::optional<result_type>
+    try_convert(const dynamic_t& from) {
+        if (from.is_string()) {
+            return boost::optional<result_type>(from.as_string().c_str());
+        } else {
+            return boost::none;
+        }
+    }
+};
+
+template<>
+struct dynamic_converter<dynamic_t::string_view_t, void> {
+    typedef dynamic_t::string_view_t result_type;
+
+    static
+    result_type
+    convert(const dynamic_t& from) {
+        return from.as_string_view();
+    }
+
+    static
+    bool
+    convertible(const dynamic_t& from) {
+        return from.is_string();
+    }
+
+    static
+    boost::optional<result_type>
+    try_convert(const dynamic_t& from) {
+        if (from.is_string()) {
+            return boost::optional<result_type>(from.as_string_view());
+        } else {
+            return boost::none;
+        }
+    }
 };
 
 template<>
@@ -129,6 +243,16 @@ struct dynamic_converter<std::vector<dynamic_t>, void> {
     convertible(const dynamic_t& from) {
         return from.is_array();
     }
+
+    static
+    boost::optional<result_type>
+    try_convert(const dynamic_t& from) {
+        if (from.is_array()) {
+            return boost::optional<result_type>(from.as_array());
+        } else {
+            return boost::none;
+        }
+    }
 };
 
 template<class T>
@@ -140,6 +264,7 @@ struct dynamic_converter<std::vector<T>, void> {
     convert(const dynamic_t& from) {
         std::vector<T> result;
         const dynamic_t::array_t& array = from.as_array();
+        result.reserve(array.size());
         for (size_t i = 0; i < array.size(); ++i) {
             result.emplace_back(array[i].to<T>());
         }
@@ -162,6 +287,31 @@ struct dynamic_converter<std::vector<T>, void> {
 
         return false;
     }
+
+    static
+    boost::optional<result_type>
+    try_convert(const dynamic_t& from) {
+        if (!from.is_array()) {
+            return boost::none;
+        }
+
+        const dynamic_t::array_t& array = from.as_array();
+
+        std::vector<T> result;
+        result.reserve(array.size());
+
+        for (size_t i = 0; i < array.size(); ++i) {
+            auto element = array[i].try_to<T>();
+
+            if (!element) {
+                return boost::none;
+            }
+
+            result.emplace_back(std::move(*element));
+        }
+
+        return boost::optional<result_type>(std::move(result));
+    }
 };
 
 template<class... Args>
@@ -196,6 +346,20 @@ struct dynamic_converter<std::tuple<Args...>, void> {
         }
     }
 
+    static
+    boost::optional<result_type>
+    try_convert(const dynamic_t& from) {
+        if (from.is_array() && sizeof...(Args) == from.as_array().size()) {
+            if (sizeof...(Args) == 0) {
+                return boost::optional<result_type>(result_type());
+            } else {
+                return range_applier<sizeof...(Args) - 1>::try_conv(from.as_array());
+            }
+        } else {
+            return boost::none;
+        }
+    }
+
 private:
     template<size_t... Idxs>
     struct range_applier;
@@ -231,6 +395,39 @@ private:
         is_conv(const dynamic_t::array_t& from) {
             return from[0].convertible_to<typename std::tuple_element<0, result_type>::type>();
         }
+
+        // Elements are converted into optionals first, the tuple is built only if all of them succeed.
+        static
+        inline
+        boost::optional<result_type>
+        try_conv(const dynamic_t::array_t& from) {
+            auto elements = std::make_tuple(
+                from[0].try_to<typename std::tuple_element<0, result_type>::type>(),
+                from[Idxs].try_to<typename std::tuple_element<Idxs, result_type>::type>()...
+            );
+
+            if (!all(std::get<0>(elements), std::get<Idxs>(elements)...)) {
+                return boost::none;
+            }
+
+            return boost::optional<result_type>(result_type(std::move(*std::get<0>(elements)), std::move(*std::get<Idxs>(elements))...));
+        }
+
+        template<class T>
+        static
+        inline
+        bool
+        all(const T& first) {
+            return static_cast<bool>(first);
+        }
+
+        template<class T, class... Tail>
+        static
+        inline
+        bool
+        all(const T& first, const Tail&... tail) {
+            return static_cast<bool>(first) && all(tail...);
+        }
     };
 };
 
@@ -249,6 +446,16 @@ struct dynamic_converter<dynamic_t::object_t, void> {
     convertible(const dynamic_t& from) {
         return from.is_object();
     }
+
+    static
+    boost::optional<result_type>
+    try_convert(const dynamic_t& from) {
+        if (from.is_object()) {
+            return boost::optional<result_type>(from.as_object());
+        } else {
+            return boost::none;
+        }
+    }
 };
 
 template<>
@@ -266,6 +473,16 @@ struct dynamic_converter<std::map<std::string, dynamic_t>, void> {
     convertible(const dynamic_t& from) {
         return from.is_object();
     }
+
+    static
+    boost::optional<result_type>
+    try_convert(const dynamic_t& from) {
+        if (from.is_object()) {
+            return boost::optional<result_type>(from.as_object());
+        } else {
+            return boost::none;
+        }
+    }
 };
 
 template<class T>
@@ -292,13 +509,37 @@ struct dynamic_converter<std::map<std::string, T>, void> {
                 if (!it->second.convertible_to<T>()) {
                     return false;
                 }
-
-                return true;
             }
+
+            return true;
         }
 
         return false;
     }
+
+    static
+    boost::optional<result_type>
+    try_convert(const dynamic_t& from) {
+        if (!from.is_object()) {
+            return boost::none;
+        }
+
+        const dynamic_t::object_t& object = from.as_object();
+
+        result_type result;
+
+        for (auto it = object.begin(); it != object.end(); ++it) {
+            auto element = it->second.try_to<T>();
+
+            if (!element) {
+                return boost::none;
+            }
+
+            result.insert(result.end(), typename result_type::value_type(it->first, std::move(*element)));
+        }
+
+        return boost::optional<result_type>(std::move(result));
+    }
 };
 
 template<class T>
@@ -310,6 +551,7 @@ struct dynamic_converter<std::unordered_map<std::string, T>, void> {
     convert(const dynamic_t& from) {
         result_type result;
         const dynamic_t::object_t& object = from.as_object();
+        result.reserve(object.size());
         for (auto it = object.begin(); it != object.end(); ++it) {
             result.insert(typename result_type::value_type(it->first, it->second.to<T>()));
         }
@@ -325,13 +567,38 @@ struct dynamic_converter<std::unordered_map<std::string, T>, void> {
                 if (!it->second.convertible_to<T>()) {
                     return false;
                 }
-
-                return true;
             }
+
+            return true;
         }
 
         return false;
     }
+
+    static
+    boost::optional<result_type>
+    try_convert(const dynamic_t& from) {
+        if (!from.is_object()) {
+            return boost::none;
+        }
+
+        const dynamic_t::object_t& object = from.as_object();
+
+        result_type result;
+        result.reserve(object.size());
+
+        for (auto it = object.begin(); it != object.end(); ++it) {
+            auto element = it->second.try_to<T>();
+
+            if (!element) {
+                return boost::none;
+            }
+
+            result.insert(result.end(), typename result_type::value_type(it->first, std::move(*element)));
+        }
+
+        return boost::optional<result_type>(std::move(result));
+    }
 };
 
 } // namespace cocaine
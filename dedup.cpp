@@ -0,0 +1,193 @@
+#include "dedup.hpp"
+
+using namespace cocaine;
+
+namespace {
+
+// Strings up to this size are stored inline by common std::string implementations,
+// sharing them would save nothing.
+const size_t inline_string_size = 15;
+
+// Finalizer of splitmix64.
+size_t
+mix(uint64_t v) {
+    v = (v ^ (v >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    v = (v ^ (v >> 27)) * 0x94d049bb133111ebULL;
+    return static_cast<size_t>(v ^ (v >> 31));
+}
+
+// Estimated heap memory owned by the node, not counting subtrees it shares with other nodes.
+size_t
+footprint(const dynamic_t& node) {
+    if (node.is_shared()) {
+        return 0;
+    } else if (node.is_string()) {
+        const dynamic_t::string_t& string = node.as_string();
+        return string.capacity() > inline_string_size ? string.capacity() + 1 : 0;
+    } else if (node.is_array()) {
+        const dynamic_t::array_t& array = node.as_array();
+        size_t result = array.capacity() * sizeof(dynamic_t);
+
+        for (auto it = array.begin(); it != array.end(); ++it) {
+            result += footprint(*it);
+        }
+
+        return result;
+    } else if (node.is_object()) {
+        const dynamic_t::object_t& object = node.as_object();
+
+        // Tree nodes carry a color and three pointers besides the value.
+        size_t result = object.size() * (sizeof(dynamic_t::object_t::value_type) + 4 * sizeof(void*));
+
+        for (auto it = object.begin(); it != object.end(); ++it) {
+            if (it->first.capacity() > inline_string_size) {
+                result += it->first.capacity() + 1;
+            }
+
+            result += footprint(it->second);
+        }
+
+        return result;
+    } else {
+        return 0;
+    }
+}
+
+} // namespace
+
+deduplicator_t::deduplicator_t() :
+    m_shared(0),
+    m_reclaimed(0),
+    m_overhead(0)
+{
+    // pass
+}
+
+void
+deduplicator_t::add(dynamic_t& root) {
+    visit(root);
+}
+
+void
+deduplicator_t::finish() {
+    for (auto it = m_table.begin(); it != m_table.end();) {
+        if (it->second.shared) {
+            it->second.first = nullptr;
+            ++it;
+        } else {
+            it = m_table.erase(it);
+        }
+    }
+}
+
+size_t
+deduplicator_t::shared() const {
+    return m_shared;
+}
+
+size_t
+deduplicator_t::reclaimed() const {
+    return m_reclaimed;
+}
+
+size_t
+deduplicator_t::overhead() const {
+    return m_overhead;
+}
+
+size_t
+deduplicator_t::visit(dynamic_t& node) {
+    if (node.is_shared()) {
+        const dynamic_t *target = boost::get<dynamic_t::shared_t>(node.m_value).get();
+        auto it = m_hashes.find(target);
+
+        // Subtrees shared by someone else are left as they are.
+        return it != m_hashes.end() ? it->second : mix(reinterpret_cast<uintptr_t>(target));
+    }
+
+    // The hashes are computed bottom-up instead of calling dynamic_t::hash() on every subtree,
+    // which would make the pass quadratic in the depth of the tree.
+    if (dynamic_t::array_t *array = boost::get<dynamic_t::array_t>(&node.m_value)) {
+        uint64_t result = 0x4000000000000007ULL + array->size();
+
+        for (auto it = array->begin(); it != array->end(); ++it) {
+            result = mix(result * 31 + visit(*it));
+        }
+
+        if (!array->empty()) {
+            intern(node, result);
+        }
+
+        return result;
+    } else if (dynamic_t::object_t *object = boost::get<dynamic_t::object_t>(&node.m_value)) {
+        uint64_t result = 0x5000000000000008ULL + object->size();
+
+        for (auto it = object->begin(); it != object->end(); ++it) {
+            result = mix(result * 31 + std::hash<std::string>()(it->first));
+            result = mix(result * 31 + visit(it->second));
+        }
+
+        if (!object->empty()) {
+            intern(node, result);
+        }
+
+        return result;
+    } else {
+        const size_t result = node.hash();
+
+        if (node.is_string() && node.as_string().size() > inline_string_size) {
+            intern(node, result);
+        }
+
+        return result;
+    }
+}
+
+void
+deduplicator_t::intern(dynamic_t& node, size_t hash) {
+    auto range = m_table.equal_range(hash);
+
+    for (auto it = range.first; it != range.second; ++it) {
+        entry_t& entry = it->second;
+
+        if (entry.first == &node) {
+            return;
+        }
+
+        // Children of both nodes have been interned already, so the comparison mostly compares pointers.
+        if (entry.shared ? *entry.shared != node : *entry.first != node) {
+            continue;
+        }
+
+        if (!entry.shared) {
+            // The first occurrence moves into the shared copy. Moving keeps the elements of its containers
+            // in place, so entries pointing into the subtree stay valid.
+            std::shared_ptr<dynamic_t> copy = std::make_shared<dynamic_t>(std::move(*entry.first));
+            entry.first->m_value = dynamic_t::shared_t(copy);
+            entry.shared = copy;
+
+            m_hashes[copy.get()] = hash;
+            m_overhead += sizeof(dynamic_t) + 2 * sizeof(void*);
+        }
+
+        m_reclaimed += footprint(node);
+        node.m_value = entry.shared;
+        ++m_shared;
+        return;
+    }
+
+    entry_t entry = { &node, dynamic_t::shared_t() };
+    m_table.insert(std::make_pair(hash, entry));
+}
+
+size_t
+cocaine::dedup(dynamic_t& root) {
+    deduplicator_t deduplicator;
+    deduplicator.add(root);
+    deduplicator.finish();
+
+    const size_t reclaimed = deduplicator.reclaimed();
+    const size_t overhead = deduplicator.overhead();
+
+    return reclaimed > overhead ? reclaimed - overhead : 0;
+}
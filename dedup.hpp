@@ -0,0 +1,72 @@
+#ifndef COCAINE_DYNAMIC_DEDUP_HPP
+#define COCAINE_DYNAMIC_DEDUP_HPP
+
+#include "dynamic.hpp"
+
+#include <unordered_map>
+
+namespace cocaine {
+
+// Hash-consing of dynamic_t trees: structurally identical subtrees (non-empty arrays and objects,
+// strings long enough to live on the heap) are replaced with references to a single immutable copy.
+// The result stays equal to the original under operator==, mutable access to a shared node
+// transparently detaches a private copy of it, and copying a deduplicated tree copies just the references.
+class deduplicator_t {
+public:
+    deduplicator_t();
+
+    // Shares subtrees of the node with identical subtrees seen so far.
+    // All nodes passed in must stay in place and must not be modified until finish() is called.
+    void
+    add(dynamic_t& root);
+
+    // Forgets subtrees which haven't been duplicated. Subtrees which have been shared already
+    // keep being used for the following documents.
+    void
+    finish();
+
+    // Number of nodes replaced with references to shared copies.
+    size_t
+    shared() const;
+
+    // Estimated amount of memory freed by dropping duplicates, in bytes.
+    size_t
+    reclaimed() const;
+
+    // Estimated amount of memory spent on shared copies, in bytes.
+    size_t
+    overhead() const;
+
+private:
+    struct entry_t {
+        // The first occurrence of the subtree, until a duplicate is found.
+        dynamic_t *first;
+        dynamic_t::shared_t shared;
+    };
+
+    // Returns the hash of the subtree computed bottom-up.
+    size_t
+    visit(dynamic_t& node);
+
+    void
+    intern(dynamic_t& node, size_t hash);
+
+private:
+    std::unordered_multimap<size_t, entry_t> m_table;
+
+    // Hashes of shared copies by their address.
+    std::unordered_map<const dynamic_t*, size_t> m_hashes;
+
+    size_t m_shared;
+    size_t m_reclaimed;
+    size_t m_overhead;
+};
+
+// Deduplicates the tree in place. Returns the estimated amount of memory reclaimed, in bytes,
+// with the overhead of shared copies subtracted.
+size_t
+dedup(dynamic_t& root);
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_DEDUP_HPP
@@ -1,5 +1,7 @@
 #include "dynamic.hpp"
 
+#include <cstring>
+
 using namespace cocaine;
 
 cocaine::dynamic_t&
@@ -27,6 +29,13 @@ detail::dynamic::object_t::operator[](const std::string& key) const {
     return at(key);
 }
 
+const std::string&
+detail::dynamic::object_t::scratch_key(boost::string_view key) {
+    static thread_local std::string scratch;
+    scratch.assign(key.data(), key.size());
+    return scratch;
+}
+
 struct is_empty_visitor :
     public boost::static_visitor<bool>
 {
@@ -66,63 +75,212 @@ struct is_empty_visitor :
     }
 };
 
-struct move_visitor :
-    public boost::static_visitor<>
+struct hash_visitor :
+    public boost::static_visitor<std::size_t>
 {
-    move_visitor(dynamic_t& dest) :
-        m_dest(dest)
-    {
-        // pass
+    std::size_t
+    operator()(const dynamic_t::null_t&) const {
+        return mix(1);
     }
 
-    template<class T>
-    void
-    operator()(T& v) const {
-        m_dest = std::move(v);
+    std::size_t
+    operator()(const dynamic_t::bool_t& v) const {
+        return mix(v ? 2 : 3);
+    }
+
+    std::size_t
+    operator()(const dynamic_t::int_t& v) const {
+        return mix(static_cast<uint64_t>(v) ^ 0x1000000000000004ULL);
+    }
+
+    std::size_t
+    operator()(const dynamic_t::double_t& v) const {
+        // 0.0 == -0.0, so they must hash the same.
+        const dynamic_t::double_t normalized = (v == 0 ? 0.0 : v);
+
+        uint64_t bits;
+        std::memcpy(&bits, &normalized, sizeof(bits));
+        return mix(bits ^ 0x2000000000000005ULL);
+    }
+
+    std::size_t
+    operator()(const dynamic_t::string_t& v) const {
+        return mix(std::hash<std::string>()(v) ^ 0x3000000000000006ULL);
+    }
+
+    std::size_t
+    operator()(const dynamic_t::array_t& v) const {
+        uint64_t result = 0x4000000000000007ULL + v.size();
+
+        for (auto it = v.begin(); it != v.end(); ++it) {
+            result = mix(result * 31 + it->hash());
+        }
+
+        return nonzero(result);
+    }
+
+    std::size_t
+    operator()(const dynamic_t::object_t& v) const {
+        uint64_t result = 0x5000000000000008ULL + v.size();
+
+        // Members are summed up, so the result doesn't depend on their order.
+        for (auto it = v.begin(); it != v.end(); ++it) {
+            result += mix(std::hash<std::string>()(it->first) * 31 + it->second.hash());
+        }
+
+        return nonzero(mix(result));
     }
 
 private:
-    dynamic_t& m_dest;
+    // Finalizer of splitmix64.
+    static
+    std::size_t
+    mix(uint64_t v) {
+        v = (v ^ (v >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        v = (v ^ (v >> 27)) * 0x94d049bb133111ebULL;
+        return nonzero(v ^ (v >> 31));
+    }
+
+    // Zero is reserved for unknown cached hashes.
+    static
+    std::size_t
+    nonzero(uint64_t v) {
+        return v == 0 ? 1 : static_cast<std::size_t>(v);
+    }
 };
 
 dynamic_t::dynamic_t() :
     m_value(null_t())
 {
-// pass
+    invalidate();
 }
 
+// Only shared subtrees keep their hashes, so copies start without one.
 dynamic_t::dynamic_t(const dynamic_t& other) :
     m_value(other.m_value)
 {
-    // pass
+    invalidate();
 }
 
 dynamic_t::dynamic_t(dynamic_t&& other) :
-    m_value(null_t())
+    m_value(std::move(other.m_value))
 {
-    other.apply(move_visitor(*this));
+    invalidate();
+
+    if (is_shared()) {
+        // Moving a shared subtree is just copying the pointer, the source keeps referring to it too.
+        other.m_value = m_value;
+    } else {
+        other.invalidate();
+    }
 }
 
 dynamic_t&
 dynamic_t::operator=(const dynamic_t& other) {
     m_value = other.m_value;
+    invalidate();
+
     return *this;
 }
 
 dynamic_t&
 dynamic_t::operator=(dynamic_t&& other) {
-    other.apply(move_visitor(*this));
+    // The other node may be a part of this one, so its value is taken out before the current value is destroyed
+    // and the other node isn't touched after that.
+    if (other.is_shared()) {
+        // Moving a shared subtree is just copying the pointer, it mustn't be detached.
+        m_value = value_t(other.m_value);
+    } else if (this != &other) {
+        // The variant moves the value directly without going through the visitors and the constructors.
+        value_t value(std::move(other.m_value));
+        other.invalidate();
+        m_value = std::move(value);
+    }
+
+    invalidate();
+
     return *this;
 }
 
 bool
 dynamic_t::operator==(const dynamic_t& other) const {
-    return m_value == other.m_value;
+#ifdef COCAINE_DYNAMIC_CACHED_HASH
+    // Shared subtrees never change, so hashes cached in them are never stale.
+    const shared_t *lhs_shared = boost::get<shared_t>(&m_value);
+    const shared_t *rhs_shared = boost::get<shared_t>(&other.m_value);
+
+    if (lhs_shared && rhs_shared) {
+        const std::size_t lhs_hash = (*lhs_shared)->m_hash.load(std::memory_order_relaxed);
+        const std::size_t rhs_hash = (*rhs_shared)->m_hash.load(std::memory_order_relaxed);
+
+        if (lhs_hash != 0 && rhs_hash != 0 && lhs_hash != rhs_hash) {
+            return false;
+        }
+    }
+#endif
+
+    const value_t& lhs = value();
+    const value_t& rhs = other.value();
+
+    // Nodes referring to the same shared subtree are equal without looking inside.
+    return &lhs == &rhs || lhs == rhs;
 }
 
 bool
 dynamic_t::operator!=(const dynamic_t& other) const {
-    return !(m_value == other.m_value);
+    return !(*this == other);
+}
+
+std::size_t
+dynamic_t::hash() const {
+#ifdef COCAINE_DYNAMIC_CACHED_HASH
+    const shared_t *shared = boost::get<shared_t>(&m_value);
+
+    if (!shared) {
+        return apply(hash_visitor());
+    }
+
+    // Nodes which may be mutated never cache their hashes, a change made through a reference taken earlier
+    // would leave the hash stale. Shared subtrees are immutable, so their hashes are computed once.
+    // The hash is a pure function of the subtree, so racing readers at worst compute it twice.
+    const dynamic_t& subtree = **shared;
+    std::size_t result = subtree.m_hash.load(std::memory_order_relaxed);
+
+    if (result == 0) {
+        result = subtree.apply(hash_visitor());
+        subtree.m_hash.store(result, std::memory_order_relaxed);
+    }
+
+    return result;
+#else
+    return apply(hash_visitor());
+#endif
+}
+
+void
+dynamic_t::reserve(size_t size) {
+    as_array().reserve(size);
+}
+
+bool
+dynamic_t::is_shared() const {
+    return static_cast<bool>(boost::get<shared_t>(&m_value));
+}
+
+void
+dynamic_t::detach() {
+    invalidate();
+
+    if (is_shared()) {
+        // The copy refers to shared grandchildren, so only one level of the subtree is duplicated.
+        dynamic_t copy(*boost::get<shared_t>(m_value));
+        m_value.swap(copy.m_value);
+    }
+}
+
+std::size_t
+cocaine::hash_value(const dynamic_t& value) {
+    return value.hash();
 }
 
 dynamic_t::bool_t
@@ -145,6 +303,11 @@ dynamic_t::as_string() const {
     return get<string_t>();
 }
 
+dynamic_t::string_view_t
+dynamic_t::as_string_view() const {
+    return string_view_t(get<string_t>());
+}
+
 const dynamic_t::array_t&
 dynamic_t::as_array() const {
     return get<array_t>();
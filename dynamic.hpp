@@ -1,17 +1,27 @@
 #ifndef COCAINE_DYNAMIC_HPP
 #define COCAINE_DYNAMIC_HPP
 
+#include <boost/optional.hpp>
+#include <boost/utility/string_view.hpp>
 #include <boost/variant.hpp>
 
+#include <atomic>
 #include <string>
 #include <vector>
+#include <functional>
 #include <map>
+#include <memory>
+#include <stdexcept>
 #include <type_traits>
+#include <tuple>
+#include <utility>
 
 namespace cocaine {
 
 class dynamic_t;
 
+class deduplicator_t;
+
 namespace detail { namespace dynamic {
 
     template<class ConstVisitor, class Result>
@@ -30,16 +40,74 @@ namespace detail { namespace dynamic {
             return m_const_visitor(static_cast<const T&>(v));
         }
 
+        // Shared nodes are visited through the node they point to.
+        template<class Node>
+        Result
+        operator()(std::shared_ptr<const Node>& v) const {
+            return v->apply(m_const_visitor);
+        }
+
     private:
         ConstVisitor m_const_visitor;
     };
 
+    template<class Visitor, class Result>
+    struct visitor_applier :
+        public boost::static_visitor<Result>
+    {
+        visitor_applier(Visitor v) :
+            m_visitor(v)
+        {
+            // pass
+        }
+
+        template<class T>
+        Result
+        operator()(T& v) const {
+            return m_visitor(v);
+        }
+
+        // Mutable visitors are applied only after the node has been detached from the shared copy.
+        template<class Node>
+        Result
+        operator()(std::shared_ptr<const Node>&) const {
+            throw std::logic_error("shared node has not been detached");
+        }
+
+    private:
+        Visitor m_visitor;
+    };
+
+
+    template<class F, bool Const, class = void>
+    struct visit_result;
+
+    template<class Converter, class = void>
+    struct try_converter;
+
+    template<class Container>
+    struct view_of;
+
+    template<class... T>
+    struct always_void {
+        typedef void type;
+    };
+
     template<class T>
     struct my_decay {
         typedef typename std::remove_reference<T>::type unref;
         typedef typename std::remove_cv<unref>::type type;
     };
 
+    // Enables the overloads taking keys which aren't std::string: string views, string literals, const char*.
+    template<class Key, class Result>
+    struct enable_for_key_view :
+        public std::enable_if<
+            std::is_convertible<const Key&, boost::string_view>::value && !std::is_same<Key, std::string>::value,
+            Result
+        >
+    { };
+
     class object_t :
         public std::map<std::string, cocaine::dynamic_t>
     {
@@ -111,6 +179,86 @@ namespace detail { namespace dynamic {
 
         const cocaine::dynamic_t&
         operator[](const std::string& key) const;
+
+        // Lookups by keys which aren't std::string, e.g. find("key") or at(view_of_network_buffer).
+        // std::map can't search by other types in C++11, so the key is copied into a per-thread buffer
+        // which keeps its capacity, and the lookups don't allocate once it has grown to the size of the keys.
+
+        using base_type::find;
+        using base_type::count;
+
+        template<class Key>
+        typename enable_for_key_view<Key, iterator>::type
+        find(const Key& key) {
+            return base_type::find(scratch_key(key));
+        }
+
+        template<class Key>
+        typename enable_for_key_view<Key, const_iterator>::type
+        find(const Key& key) const {
+            return base_type::find(scratch_key(key));
+        }
+
+        template<class Key>
+        typename enable_for_key_view<Key, size_type>::type
+        count(const Key& key) const {
+            return base_type::count(scratch_key(key));
+        }
+
+        // Throw std::out_of_range if there is no such key.
+        template<class Key>
+        typename enable_for_key_view<Key, cocaine::dynamic_t&>::type
+        at(const Key& key) {
+            return base_type::at(scratch_key(key));
+        }
+
+        template<class Key>
+        typename enable_for_key_view<Key, const cocaine::dynamic_t&>::type
+        at(const Key& key) const {
+            return base_type::at(scratch_key(key));
+        }
+
+        template<class Key>
+        typename enable_for_key_view<Key, cocaine::dynamic_t&>::type
+        at(const Key& key, cocaine::dynamic_t& def) {
+            return at(scratch_key(key), def);
+        }
+
+        template<class Key>
+        typename enable_for_key_view<Key, const cocaine::dynamic_t&>::type
+        at(const Key& key, const cocaine::dynamic_t& def) const {
+            return at(scratch_key(key), def);
+        }
+
+        // Allocates the key only if it's inserted.
+        template<class Key>
+        typename enable_for_key_view<Key, cocaine::dynamic_t&>::type
+        operator[](const Key& key);
+
+        template<class Key>
+        typename enable_for_key_view<Key, const cocaine::dynamic_t&>::type
+        operator[](const Key& key) const {
+            return base_type::at(scratch_key(key));
+        }
+
+        // Like std::map::try_emplace() from C++17: constructs the value in place from the arguments
+        // only if there is no such key yet, and neither the key nor the value are moved from otherwise.
+        template<class... Args>
+        std::pair<iterator, bool>
+        try_emplace(const std::string& key, Args&&... args);
+
+        template<class... Args>
+        std::pair<iterator, bool>
+        try_emplace(std::string&& key, Args&&... args);
+
+        template<class Key, class... Args>
+        typename enable_for_key_view<Key, std::pair<iterator, bool>>::type
+        try_emplace(const Key& key, Args&&... args);
+
+    private:
+        static
+        const std::string&
+        scratch_key(boost::string_view key);
     };
 
 }} // namespace detail::dynamic
@@ -142,18 +290,27 @@ public:
             double_t;
     typedef std::string
             string_t;
+    typedef boost::string_view
+            string_view_t;
     typedef std::vector<dynamic_t>
             array_t;
     typedef detail::dynamic::object_t
             object_t;
 
+    // Immutable subtree shared between several nodes, see dedup.hpp.
+    // Accessors look through it transparently and mutable access detaches a private copy,
+    // so visitors and converters never see this type.
+    typedef std::shared_ptr<const dynamic_t>
+            shared_t;
+
     typedef boost::variant<null_t,
                            bool_t,
                            int_t,
                            double_t,
                            string_t,
                            array_t,
-                           object_t>
+                           object_t,
+                           shared_t>
             value_t;
 
 public:
@@ -185,16 +342,32 @@ public:
     bool
     operator!=(const dynamic_t& other) const;
 
+    // Structural hash consistent with operator==: object members are combined in an order-independent way,
+    // ints and doubles hash differently just like they compare unequal.
+    // With COCAINE_DYNAMIC_CACHED_HASH defined, hashes of shared subtrees (see dedup.hpp) are cached inside them,
+    // which also lets operator== bail out early on shared subtrees with mismatching hashes. Other nodes may be
+    // changed through references taken at any time, so their hashes are always computed anew.
+    std::size_t
+    hash() const;
+
     template<class Visitor>
     typename Visitor::result_type
     apply(Visitor& visitor) {
-        return boost::apply_visitor(visitor, m_value);
+        detach();
+        return boost::apply_visitor(
+            detail::dynamic::visitor_applier<Visitor&, typename Visitor::result_type>(visitor),
+            m_value
+        );
     }
 
     template<class Visitor>
     typename Visitor::result_type
     apply(const Visitor& visitor) {
-        return boost::apply_visitor(visitor, m_value);
+        detach();
+        return boost::apply_visitor(
+            detail::dynamic::visitor_applier<const Visitor&, typename Visitor::result_type>(visitor),
+            m_value
+        );
     }
 
     template<class Visitor>
@@ -215,6 +388,18 @@ public:
         );
     }
 
+    // Calls the function with the stored value, e.g. visit(overloaded([](const string_t&) { ... }, ...)).
+    // The function is dispatched with a single jump over the type of the value without intermediate
+    // visitor objects, see visit.hpp. The result type is the common type of the results
+    // of all overloads. The non-constant version detaches the node from a shared subtree first.
+    template<class F>
+    typename detail::dynamic::visit_result<F, true>::type
+    visit(F&& f) const;
+
+    template<class F>
+    typename detail::dynamic::visit_result<F, false>::type
+    visit(F&& f);
+
     bool
     is_null() const;
 
@@ -248,6 +433,10 @@ public:
     const string_t&
     as_string() const;
 
+    // Non-owning view of the string, valid while the string is alive and unmodified.
+    string_view_t
+    as_string_view() const;
+
     const array_t&
     as_array() const;
 
@@ -276,42 +465,185 @@ public:
     typename dynamic_converter<typename detail::dynamic::my_decay<T>::type>::result_type
     to() const;
 
+    // Validates and converts the value in a single pass without throwing on mismatching types.
+    // Returns an empty optional if convertible_to<T>() would return false.
+    // Converters without try_convert() fall back to convertible() followed by convert().
+    template<class T>
+    boost::optional<typename dynamic_converter<typename detail::dynamic::my_decay<T>::type>::result_type>
+    try_to() const;
+
+    // Non-owning range over the array or the object which converts the elements on dereference instead of
+    // copying them into a new container: as_view<std::vector<int>>() is array_view_t<int> and
+    // as_view<std::map<std::string, int>>() is object_view_t<int>, see view.hpp.
+    // Throws boost::bad_get if the value isn't an array or an object respectively.
+    template<class Container>
+    typename detail::dynamic::view_of<Container>::type
+    as_view() const;
+
+    // Appends an element constructed in place from the arguments, which are anything dynamic_t is constructible
+    // from, and returns it. Null values become arrays, like with as_array().
+    template<class... Args>
+    dynamic_t&
+    emplace_back(Args&&... args);
+
+    // Inserts a member constructed in place if there is no such key yet, see object_t::try_emplace().
+    // Null values become objects.
+    template<class Key, class... Args>
+    std::pair<object_t::iterator, bool>
+    try_emplace(Key&& key, Args&&... args);
+
+    // Reserves space in the array. Null values become arrays.
+    void
+    reserve(size_t size);
+
+    // Whether the node refers to a subtree shared with other nodes.
+    bool
+    is_shared() const;
+
 private:
+    friend class deduplicator_t;
+
     template<class T>
     T&
     get() {
+        detach();
         return boost::get<T>(m_value);
     }
 
     template<class T>
     const T&
     get() const {
-        return boost::get<T>(m_value);
+        return boost::get<T>(value());
     }
 
     template<class T>
     bool
     is() const {
-        return static_cast<bool>(boost::get<T>(&m_value));
+        return static_cast<bool>(boost::get<T>(&value()));
+    }
+
+    // The value of the node itself or of the shared subtree it refers to.
+    value_t&
+    value() const {
+        const shared_t *shared = boost::get<shared_t>(&m_value);
+        return shared ? (*shared)->m_value : m_value;
+    }
+
+    // Replaces the reference to a shared subtree with a private copy of it.
+    void
+    detach();
+
+    void
+    invalidate() {
+#ifdef COCAINE_DYNAMIC_CACHED_HASH
+        m_hash.store(0, std::memory_order_relaxed);
+#endif
     }
 
 private:
     // boost::apply_visitor takes non-constant reference to variable object
     mutable value_t m_value;
+
+#ifdef COCAINE_DYNAMIC_CACHED_HASH
+    // Hash of the subtree if the node is the immutable target of shared nodes, zero otherwise or if it isn't known yet.
+    // Readers of a shared subtree may fill it concurrently, they all store the same value.
+    mutable std::atomic<std::size_t> m_hash;
+#endif
 };
 
+std::size_t
+hash_value(const dynamic_t& value);
+
+template<class Key>
+typename detail::dynamic::enable_for_key_view<Key, dynamic_t&>::type
+detail::dynamic::object_t::operator[](const Key& key) {
+    const std::string& scratch = scratch_key(key);
+    auto it = lower_bound(scratch);
+
+    if (it != end() && it->first == scratch) {
+        return it->second;
+    }
+
+    const boost::string_view view(key);
+    return emplace_hint(it, std::piecewise_construct, std::forward_as_tuple(view.data(), view.size()), std::tuple<>())->second;
+}
+
+template<class... Args>
+std::pair<detail::dynamic::object_t::iterator, bool>
+detail::dynamic::object_t::try_emplace(const std::string& key, Args&&... args) {
+    auto it = lower_bound(key);
+
+    if (it != end() && it->first == key) {
+        return std::make_pair(it, false);
+    }
+
+    it = emplace_hint(it, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+    return std::make_pair(it, true);
+}
+
+template<class... Args>
+std::pair<detail::dynamic::object_t::iterator, bool>
+detail::dynamic::object_t::try_emplace(std::string&& key, Args&&... args) {
+    auto it = lower_bound(key);
+
+    if (it != end() && it->first == key) {
+        return std::make_pair(it, false);
+    }
+
+    it = emplace_hint(it, std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+    return std::make_pair(it, true);
+}
+
+template<class Key, class... Args>
+typename detail::dynamic::enable_for_key_view<Key, std::pair<detail::dynamic::object_t::iterator, bool>>::type
+detail::dynamic::object_t::try_emplace(const Key& key, Args&&... args) {
+    const std::string& scratch = scratch_key(key);
+    auto it = lower_bound(scratch);
+
+    if (it != end() && it->first == scratch) {
+        return std::make_pair(it, false);
+    }
+
+    const boost::string_view view(key);
+
+    it = emplace_hint(
+        it,
+        std::piecewise_construct,
+        std::forward_as_tuple(view.data(), view.size()),
+        std::forward_as_tuple(std::forward<Args>(args)...)
+    );
+
+    return std::make_pair(it, true);
+}
+
+template<class... Args>
+dynamic_t&
+dynamic_t::emplace_back(Args&&... args) {
+    array_t& array = as_array();
+    array.emplace_back(std::forward<Args>(args)...);
+    return array.back();
+}
+
+template<class Key, class... Args>
+std::pair<dynamic_t::object_t::iterator, bool>
+dynamic_t::try_emplace(Key&& key, Args&&... args) {
+    return as_object().try_emplace(std::forward<Key>(key), std::forward<Args>(args)...);
+}
+
 template<class T>
 dynamic_t::dynamic_t(
     T&& from,
     typename std::enable_if<dynamic_constructor<typename detail::dynamic::my_decay<T>::type>::enable>::type*
 ) : m_value(null_t())
 {
+    invalidate();
     dynamic_constructor<typename detail::dynamic::my_decay<T>::type>::convert(std::forward<T>(from), m_value);
 }
 
 template<class T>
 typename std::enable_if<dynamic_constructor<typename detail::dynamic::my_decay<T>::type>::enable, dynamic_t&>::type
 dynamic_t::operator=(T&& from) {
+    invalidate();
     dynamic_constructor<typename detail::dynamic::my_decay<T>::type>::convert(std::forward<T>(from), m_value);
     return *this;
 }
@@ -332,9 +664,29 @@ dynamic_t::to() const {
     return dynamic_converter<typename detail::dynamic::my_decay<T>::type>::convert(*this);
 }
 
+template<class T>
+boost::optional<typename dynamic_converter<typename detail::dynamic::my_decay<T>::type>::result_type>
+dynamic_t::try_to() const {
+    return detail::dynamic::try_converter<dynamic_converter<typename detail::dynamic::my_decay<T>::type>>::convert(*this);
+}
+
 } // namespace cocaine
 
+namespace std {
+
+template<>
+struct hash<cocaine::dynamic_t> {
+    size_t
+    operator()(const cocaine::dynamic_t& value) const {
+        return value.hash();
+    }
+};
+
+} // namespace std
+
 #include "constructors.hpp"
 #include "converters.hpp"
+#include "visit.hpp"
+#include "view.hpp"
 
 #endif // COCAINE_DYNAMIC_HPP
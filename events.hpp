@@ -0,0 +1,108 @@
+#ifndef COCAINE_DYNAMIC_EVENTS_HPP
+#define COCAINE_DYNAMIC_EVENTS_HPP
+
+#include "dynamic.hpp"
+
+#include <cstddef>
+
+namespace cocaine {
+
+// Event-based (SAX-like) representation of a dynamic document.
+// A handler is any class with the following members:
+//
+//     void null_value();
+//     void bool_value(dynamic_t::bool_t v);
+//     void int_value(dynamic_t::int_t v);
+//     void double_value(dynamic_t::double_t v);
+//     void string_value(const char *data, size_t size);
+//     void begin_array(size_t size);
+//     void end_array();
+//     void begin_object(size_t size);
+//     void key(const char *data, size_t size);
+//     void end_object();
+//
+// Each object member is reported as a key event followed by the events of its value.
+// Producers which don't know the size of a container in advance pass events::unknown_size.
+namespace events {
+
+    static const size_t unknown_size = static_cast<size_t>(-1);
+
+} // namespace events
+
+namespace detail { namespace dynamic {
+
+    template<class Handler>
+    struct emit_visitor :
+        public boost::static_visitor<>
+    {
+        emit_visitor(Handler& handler) :
+            m_handler(handler)
+        {
+            // pass
+        }
+
+        void
+        operator()(const dynamic_t::null_t&) const {
+            m_handler.null_value();
+        }
+
+        void
+        operator()(const dynamic_t::bool_t& v) const {
+            m_handler.bool_value(v);
+        }
+
+        void
+        operator()(const dynamic_t::int_t& v) const {
+            m_handler.int_value(v);
+        }
+
+        void
+        operator()(const dynamic_t::double_t& v) const {
+            m_handler.double_value(v);
+        }
+
+        void
+        operator()(const dynamic_t::string_t& v) const {
+            m_handler.string_value(v.data(), v.size());
+        }
+
+        void
+        operator()(const dynamic_t::array_t& v) const {
+            m_handler.begin_array(v.size());
+
+            for(size_t i = 0; i < v.size(); ++i) {
+                v[i].apply(*this);
+            }
+
+            m_handler.end_array();
+        }
+
+        void
+        operator()(const dynamic_t::object_t& v) const {
+            m_handler.begin_object(v.size());
+
+            for(auto it = v.begin(); it != v.end(); ++it) {
+                m_handler.key(it->first.data(), it->first.size());
+                it->second.apply(*this);
+            }
+
+            m_handler.end_object();
+        }
+
+    private:
+        Handler& m_handler;
+    };
+
+}} // namespace detail::dynamic
+
+// Reports the whole document to the handler.
+template<class Handler>
+inline
+void
+emit(const dynamic_t& source, Handler& handler) {
+    source.apply(detail::dynamic::emit_visitor<Handler>(handler));
+}
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_EVENTS_HPP
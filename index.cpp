@@ -0,0 +1,120 @@
+#include "index.hpp"
+
+using namespace cocaine;
+
+namespace {
+
+const std::vector<size_t> no_positions;
+
+} // namespace
+
+const size_t unique_index_t::npos;
+
+unique_index_t::unique_index_t(const dynamic_t::array_t& array, const path_t& key) :
+    m_array(&array),
+    m_key(key),
+    m_indexed(0)
+{
+    update();
+}
+
+const dynamic_t*
+unique_index_t::find(const dynamic_t& key) const {
+    auto it = m_positions.find(key);
+    return it == m_positions.end() ? nullptr : &(*m_array)[it->second];
+}
+
+size_t
+unique_index_t::position(const dynamic_t& key) const {
+    auto it = m_positions.find(key);
+    return it == m_positions.end() ? npos : it->second;
+}
+
+bool
+unique_index_t::contains(const dynamic_t& key) const {
+    return m_positions.count(key) != 0;
+}
+
+size_t
+unique_index_t::size() const {
+    return m_positions.size();
+}
+
+void
+unique_index_t::update() {
+    if (m_array->size() < m_indexed) {
+        rebuild();
+        return;
+    }
+
+    for (; m_indexed < m_array->size(); ++m_indexed) {
+        const dynamic_t *value = m_key.get((*m_array)[m_indexed]);
+
+        if (value && !m_positions.insert(std::make_pair(*value, m_indexed)).second) {
+            throw index_error("duplicate key at " + std::to_string(m_indexed));
+        }
+    }
+}
+
+void
+unique_index_t::rebuild() {
+    m_positions.clear();
+    m_indexed = 0;
+    update();
+}
+
+multi_index_t::multi_index_t(const dynamic_t::array_t& array, const path_t& key) :
+    m_array(&array),
+    m_key(key),
+    m_indexed(0)
+{
+    update();
+}
+
+const std::vector<size_t>&
+multi_index_t::positions(const dynamic_t& key) const {
+    auto it = m_positions.find(key);
+    return it == m_positions.end() ? no_positions : it->second;
+}
+
+void
+multi_index_t::find(const dynamic_t& key, std::vector<const dynamic_t*>& result) const {
+    const std::vector<size_t>& found = positions(key);
+
+    for (auto it = found.begin(); it != found.end(); ++it) {
+        result.push_back(&(*m_array)[*it]);
+    }
+}
+
+size_t
+multi_index_t::count(const dynamic_t& key) const {
+    return positions(key).size();
+}
+
+size_t
+multi_index_t::size() const {
+    return m_positions.size();
+}
+
+void
+multi_index_t::update() {
+    if (m_array->size() < m_indexed) {
+        rebuild();
+        return;
+    }
+
+    for (; m_indexed < m_array->size(); ++m_indexed) {
+        const dynamic_t *value = m_key.get((*m_array)[m_indexed]);
+
+        if (value) {
+            m_positions[*value].push_back(m_indexed);
+        }
+    }
+}
+
+void
+multi_index_t::rebuild() {
+    m_positions.clear();
+    m_indexed = 0;
+    update();
+}
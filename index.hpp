@@ -0,0 +1,113 @@
+#ifndef COCAINE_DYNAMIC_INDEX_HPP
+#define COCAINE_DYNAMIC_INDEX_HPP
+
+#include "dynamic.hpp"
+#include "path.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cocaine {
+
+struct index_error :
+    public std::runtime_error
+{
+    index_error(const std::string& message) :
+        std::runtime_error(message)
+    {
+        // pass
+    }
+};
+
+// Hash indexes over an array of objects keyed by the value at a path inside each element,
+// e.g. unique_index_t(users, path_t("/id")). Keys compare with dynamic_t::operator==, so 1 and 1.0 are
+// different keys. Elements without the key are not indexed.
+//
+// Indexes refer to the array and remember positions of the elements, not pointers to them.
+// Appending elements to the array (even if it reallocates) keeps the index valid: update() indexes
+// the new elements only. Any other mutation through as_array() or the elements themselves — erasing,
+// inserting in the middle, reordering, changing key values — requires rebuild(), and lookups return
+// stale results until then. The array itself must outlive the index: note that mutable access to a node
+// sharing its subtree (see dedup.hpp) detaches a private copy of the array, so the index must be built
+// over the array returned by the mutable as_array() if the array is going to be appended to.
+
+class unique_index_t {
+public:
+    static const size_t npos = static_cast<size_t>(-1);
+
+public:
+    // Throws index_error if two elements have the same key.
+    unique_index_t(const dynamic_t::array_t& array, const path_t& key);
+
+    // Returns nullptr if there is no element with this key.
+    const dynamic_t*
+    find(const dynamic_t& key) const;
+
+    // Returns npos if there is no element with this key.
+    size_t
+    position(const dynamic_t& key) const;
+
+    bool
+    contains(const dynamic_t& key) const;
+
+    // Number of indexed elements.
+    size_t
+    size() const;
+
+    // Indexes the elements appended since the last update. Rebuilds the index if the array has shrunk.
+    // Throws index_error on a duplicate key, in which case the index covers the elements before it.
+    void
+    update();
+
+    void
+    rebuild();
+
+private:
+    const dynamic_t::array_t *m_array;
+    path_t m_key;
+
+    // Number of elements of the array looked at so far.
+    size_t m_indexed;
+
+    std::unordered_map<dynamic_t, size_t> m_positions;
+};
+
+class multi_index_t {
+public:
+    multi_index_t(const dynamic_t::array_t& array, const path_t& key);
+
+    // Positions of the elements with this key in ascending order. The reference is valid until the next update.
+    const std::vector<size_t>&
+    positions(const dynamic_t& key) const;
+
+    // Appends pointers to the elements with this key to the result.
+    void
+    find(const dynamic_t& key, std::vector<const dynamic_t*>& result) const;
+
+    size_t
+    count(const dynamic_t& key) const;
+
+    // Number of distinct keys.
+    size_t
+    size() const;
+
+    // Indexes the elements appended since the last update. Rebuilds the index if the array has shrunk.
+    void
+    update();
+
+    void
+    rebuild();
+
+private:
+    const dynamic_t::array_t *m_array;
+    path_t m_key;
+    size_t m_indexed;
+
+    std::unordered_map<dynamic_t, std::vector<size_t>> m_positions;
+};
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_INDEX_HPP
@@ -0,0 +1,593 @@
+#ifndef COCAINE_DYNAMIC_JSON_HPP
+#define COCAINE_DYNAMIC_JSON_HPP
+
+#include "dynamic.hpp"
+#include "events.hpp"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cocaine { namespace io {
+
+struct json_error :
+    public std::runtime_error
+{
+    json_error(const std::string& message, size_t offset) :
+        std::runtime_error(message + " at offset " + std::to_string(offset)),
+        m_offset(offset)
+    {
+        // pass
+    }
+
+    size_t
+    offset() const {
+        return m_offset;
+    }
+
+private:
+    size_t m_offset;
+};
+
+// Event handler which writes JSON text into the stream.
+// Stream is anything with write(const char*, size_t), like msgpack::sbuffer or std::ostream.
+template<class Stream>
+class json_writer_t {
+public:
+    json_writer_t(Stream& stream) :
+        m_stream(stream),
+        m_after_key(false)
+    {
+        // pass
+    }
+
+    void
+    null_value() {
+        separate();
+        write("null", 4);
+    }
+
+    void
+    bool_value(dynamic_t::bool_t v) {
+        separate();
+
+        if (v) {
+            write("true", 4);
+        } else {
+            write("false", 5);
+        }
+    }
+
+    void
+    int_value(dynamic_t::int_t v) {
+        separate();
+
+        char buffer[32];
+        int size = std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(v));
+        write(buffer, size);
+    }
+
+    void
+    double_value(dynamic_t::double_t v) {
+        separate();
+
+        if (!std::isfinite(v)) {
+            // NOTE: JSON has no representation for infinities and NaNs.
+            write("null", 4);
+            return;
+        }
+
+        char buffer[32];
+        int size = std::snprintf(buffer, sizeof(buffer), "%.17g", v);
+        write(buffer, size);
+
+        // Keep the value a double when it's read back.
+        for (int i = 0; i < size; ++i) {
+            if (buffer[i] == '.' || buffer[i] == 'e') {
+                return;
+            }
+        }
+
+        write(".0", 2);
+    }
+
+    void
+    string_value(const char *data, size_t size) {
+        separate();
+        write_string(data, size);
+    }
+
+    void
+    begin_array(size_t) {
+        separate();
+        write("[", 1);
+        m_first.push_back(true);
+    }
+
+    void
+    end_array() {
+        m_first.pop_back();
+        write("]", 1);
+    }
+
+    void
+    begin_object(size_t) {
+        separate();
+        write("{", 1);
+        m_first.push_back(true);
+    }
+
+    void
+    key(const char *data, size_t size) {
+        separate();
+        write_string(data, size);
+        write(":", 1);
+        m_after_key = true;
+    }
+
+    void
+    end_object() {
+        m_first.pop_back();
+        write("}", 1);
+    }
+
+private:
+    void
+    separate() {
+        if (m_after_key) {
+            m_after_key = false;
+        } else if (!m_first.empty()) {
+            if (!m_first.back()) {
+                write(",", 1);
+            }
+
+            m_first.back() = false;
+        }
+    }
+
+    void
+    write_string(const char *data, size_t size) {
+        static const char hex[] = "0123456789abcdef";
+
+        write("\"", 1);
+
+        size_t begin = 0;
+
+        for (size_t i = 0; i < size; ++i) {
+            const unsigned char c = data[i];
+
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+
+            write(data + begin, i - begin);
+            begin = i + 1;
+
+            switch (c) {
+            case '"': write("\\\"", 2); break;
+            case '\\': write("\\\\", 2); break;
+            case '\b': write("\\b", 2); break;
+            case '\f': write("\\f", 2); break;
+            case '\n': write("\\n", 2); break;
+            case '\r': write("\\r", 2); break;
+            case '\t': write("\\t", 2); break;
+            default: {
+                char escaped[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0f] };
+                write(escaped, 6);
+            }}
+        }
+
+        write(data + begin, size - begin);
+        write("\"", 1);
+    }
+
+    void
+    write(const char *data, size_t size) {
+        m_stream.write(data, size);
+    }
+
+private:
+    Stream& m_stream;
+
+    // One entry per open container: whether no elements have been written into it yet.
+    std::vector<bool> m_first;
+    bool m_after_key;
+};
+
+// Parses JSON text and reports it to the handler token by token.
+// Memory usage is proportional to the nesting depth (plus the longest escaped string),
+// containers are reported with events::unknown_size.
+template<class Handler>
+class json_parser_t {
+public:
+    json_parser_t(Handler& handler) :
+        m_handler(handler),
+        m_data(nullptr),
+        m_size(0),
+        m_offset(0),
+        m_opened(false)
+    {
+        // pass
+    }
+
+    // Parses a single JSON value. Returns the number of bytes consumed, trailing whitespace included.
+    size_t
+    parse(const char *data, size_t size) {
+        m_data = data;
+        m_size = size;
+        m_offset = 0;
+        m_stack.clear();
+        m_opened = false;
+
+        skip_whitespace();
+        parse_value();
+
+        while (!m_stack.empty()) {
+            skip_whitespace();
+
+            const bool is_object = m_stack.back();
+
+            if (m_opened) {
+                m_opened = false;
+
+                if (is_object) {
+                    parse_key();
+                    skip_whitespace();
+                }
+
+                parse_value();
+            } else if (peek() == ',') {
+                ++m_offset;
+                skip_whitespace();
+
+                if (is_object) {
+                    parse_key();
+                    skip_whitespace();
+                }
+
+                parse_value();
+            } else if (peek() == (is_object ? '}' : ']')) {
+                ++m_offset;
+                m_stack.pop_back();
+
+                if (is_object) {
+                    m_handler.end_object();
+                } else {
+                    m_handler.end_array();
+                }
+            } else {
+                fail("expected ',' or end of container");
+            }
+        }
+
+        skip_whitespace();
+        return m_offset;
+    }
+
+private:
+    // Reports a scalar or opens a container. Elements of the container are handled by parse(),
+    // so the nesting depth doesn't affect the call stack.
+    void
+    parse_value() {
+        switch (peek()) {
+        case '{': {
+            ++m_offset;
+            m_handler.begin_object(events::unknown_size);
+            skip_whitespace();
+
+            if (peek() == '}') {
+                ++m_offset;
+                m_handler.end_object();
+            } else {
+                m_stack.push_back(true);
+                m_opened = true;
+            }
+        } break;
+
+        case '[': {
+            ++m_offset;
+            m_handler.begin_array(events::unknown_size);
+            skip_whitespace();
+
+            if (peek() == ']') {
+                ++m_offset;
+                m_handler.end_array();
+            } else {
+                m_stack.push_back(false);
+                m_opened = true;
+            }
+        } break;
+
+        case '"': {
+            parse_string();
+            m_handler.string_value(m_string.data(), m_string.size());
+        } break;
+
+        case 't': {
+            expect("true");
+            m_handler.bool_value(true);
+        } break;
+
+        case 'f': {
+            expect("false");
+            m_handler.bool_value(false);
+        } break;
+
+        case 'n': {
+            expect("null");
+            m_handler.null_value();
+        } break;
+
+        default:
+            parse_number();
+        }
+    }
+
+    void
+    parse_key() {
+        if (peek() != '"') {
+            fail("expected object key");
+        }
+
+        parse_string();
+        m_handler.key(m_string.data(), m_string.size());
+        skip_whitespace();
+
+        if (peek() != ':') {
+            fail("expected ':'");
+        }
+
+        ++m_offset;
+        skip_whitespace();
+    }
+
+    void
+    parse_number() {
+        const size_t begin = m_offset;
+        bool is_double = false;
+
+        if (peek() == '-') {
+            ++m_offset;
+        }
+
+        if (!is_digit(peek())) {
+            fail("unexpected character");
+        }
+
+        while (is_digit(peek())) {
+            ++m_offset;
+        }
+
+        if (peek() == '.') {
+            is_double = true;
+            ++m_offset;
+
+            if (!is_digit(peek())) {
+                fail("expected digit");
+            }
+
+            while (is_digit(peek())) {
+                ++m_offset;
+            }
+        }
+
+        if (peek() == 'e' || peek() == 'E') {
+            is_double = true;
+            ++m_offset;
+
+            if (peek() == '+' || peek() == '-') {
+                ++m_offset;
+            }
+
+            if (!is_digit(peek())) {
+                fail("expected digit");
+            }
+
+            while (is_digit(peek())) {
+                ++m_offset;
+            }
+        }
+
+        // strtod and strtoll need a null-terminated string.
+        m_string.assign(m_data + begin, m_offset - begin);
+
+        if (!is_double) {
+            errno = 0;
+            long long v = std::strtoll(m_string.c_str(), nullptr, 10);
+
+            if (errno != ERANGE) {
+                m_handler.int_value(v);
+                return;
+            }
+        }
+
+        m_handler.double_value(std::strtod(m_string.c_str(), nullptr));
+    }
+
+    void
+    parse_string() {
+        // Skip the opening quote.
+        ++m_offset;
+        m_string.clear();
+
+        size_t begin = m_offset;
+
+        while (true) {
+            if (m_offset >= m_size) {
+                fail("unterminated string");
+            }
+
+            const unsigned char c = m_data[m_offset];
+
+            if (c == '"') {
+                m_string.append(m_data + begin, m_offset - begin);
+                ++m_offset;
+                return;
+            } else if (c < 0x20) {
+                fail("control character in string");
+            } else if (c == '\\') {
+                m_string.append(m_data + begin, m_offset - begin);
+                ++m_offset;
+                parse_escape();
+                begin = m_offset;
+            } else {
+                ++m_offset;
+            }
+        }
+    }
+
+    void
+    parse_escape() {
+        switch (peek()) {
+        case '"': m_string.push_back('"'); break;
+        case '\\': m_string.push_back('\\'); break;
+        case '/': m_string.push_back('/'); break;
+        case 'b': m_string.push_back('\b'); break;
+        case 'f': m_string.push_back('\f'); break;
+        case 'n': m_string.push_back('\n'); break;
+        case 'r': m_string.push_back('\r'); break;
+        case 't': m_string.push_back('\t'); break;
+        case 'u': {
+            ++m_offset;
+            unsigned long code = parse_hex();
+
+            if (code >= 0xd800 && code < 0xdc00) {
+                // Surrogate pair.
+                if (peek() != '\\' || m_offset + 1 >= m_size || m_data[m_offset + 1] != 'u') {
+                    fail("expected low surrogate");
+                }
+
+                m_offset += 2;
+                unsigned long low = parse_hex();
+
+                if (low < 0xdc00 || low >= 0xe000) {
+                    fail("invalid low surrogate");
+                }
+
+                code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+            }
+
+            append_utf8(code);
+        } return;
+
+        default:
+            fail("invalid escape sequence");
+        }
+
+        ++m_offset;
+    }
+
+    unsigned long
+    parse_hex() {
+        if (m_offset + 4 > m_size) {
+            fail("truncated unicode escape");
+        }
+
+        unsigned long code = 0;
+
+        for (size_t i = 0; i < 4; ++i, ++m_offset) {
+            const char c = m_data[m_offset];
+            code <<= 4;
+
+            if (c >= '0' && c <= '9') {
+                code |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                code |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                code |= c - 'A' + 10;
+            } else {
+                fail("invalid unicode escape");
+            }
+        }
+
+        return code;
+    }
+
+    void
+    append_utf8(unsigned long code) {
+        if (code < 0x80) {
+            m_string.push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            m_string.push_back(static_cast<char>(0xc0 | (code >> 6)));
+            m_string.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+        } else if (code < 0x10000) {
+            m_string.push_back(static_cast<char>(0xe0 | (code >> 12)));
+            m_string.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+            m_string.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+        } else {
+            m_string.push_back(static_cast<char>(0xf0 | (code >> 18)));
+            m_string.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3f)));
+            m_string.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+            m_string.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+        }
+    }
+
+    void
+    expect(const char *literal) {
+        for (; *literal; ++literal, ++m_offset) {
+            if (peek() != *literal) {
+                fail("invalid literal");
+            }
+        }
+    }
+
+    void
+    skip_whitespace() {
+        while (m_offset < m_size) {
+            const char c = m_data[m_offset];
+
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+                break;
+            }
+
+            ++m_offset;
+        }
+    }
+
+    char
+    peek() const {
+        return m_offset < m_size ? m_data[m_offset] : '\0';
+    }
+
+    static
+    bool
+    is_digit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    void
+    fail(const char *message) const {
+        throw json_error(message, m_offset);
+    }
+
+private:
+    Handler& m_handler;
+
+    const char *m_data;
+    size_t m_size;
+    size_t m_offset;
+
+    // One entry per open container: true for objects, false for arrays.
+    std::vector<bool> m_stack;
+
+    // Whether the innermost container has just been opened and has no elements parsed yet.
+    bool m_opened;
+
+    // Scratch buffer for unescaped strings and number tokens.
+    std::string m_string;
+};
+
+template<class Handler>
+inline
+size_t
+parse_json(const char *data, size_t size, Handler& handler) {
+    return json_parser_t<Handler>(handler).parse(data, size);
+}
+
+}} // namespace cocaine::io
+
+#endif // COCAINE_DYNAMIC_JSON_HPP
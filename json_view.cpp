@@ -0,0 +1,587 @@
+#include "json_view.hpp"
+
+#include "builder.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using namespace cocaine;
+using namespace cocaine::io;
+
+namespace {
+
+bool
+is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+size_t
+skip_space(const char *data, size_t size, size_t offset) {
+    while (offset < size && is_space(data[offset])) {
+        ++offset;
+    }
+
+    return offset;
+}
+
+// Returns the offset right after the closing quote of the string which starts at the offset.
+size_t
+skip_string(const char *data, size_t size, size_t offset) {
+    for (++offset; offset < size; ++offset) {
+        if (data[offset] == '\\') {
+            ++offset;
+        } else if (data[offset] == '"') {
+            return offset + 1;
+        }
+    }
+
+    throw json_error("unterminated string", size);
+}
+
+// Returns the offset right after the value which starts at the offset.
+// Brackets are expected to be balanced already, so containers are skipped without looking inside.
+size_t
+skip_value(const char *data, size_t size, size_t offset) {
+    if (offset >= size) {
+        throw json_error("expected value", offset);
+    }
+
+    const char c = data[offset];
+
+    if (c == '"') {
+        return skip_string(data, size, offset);
+    } else if (c == '{' || c == '[') {
+        size_t depth = 0;
+
+        while (offset < size) {
+            const char c = data[offset];
+
+            if (c == '"') {
+                offset = skip_string(data, size, offset);
+                continue;
+            } else if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                --depth;
+            }
+
+            ++offset;
+
+            if (depth == 0) {
+                return offset;
+            }
+        }
+
+        throw json_error("unterminated container", offset);
+    } else {
+        const size_t begin = offset;
+
+        while (offset < size) {
+            const char c = data[offset];
+
+            if (is_space(c) || c == ',' || c == ':' || c == ']' || c == '}') {
+                break;
+            }
+
+            ++offset;
+        }
+
+        if (offset == begin) {
+            throw json_error("expected value", offset);
+        }
+
+        return offset;
+    }
+}
+
+// Checks that strings are terminated and brackets are balanced.
+void
+check_structure(const char *data, size_t size) {
+    std::vector<char> closers;
+
+    for (size_t offset = 0; offset < size;) {
+        const char c = data[offset];
+
+        if (c == '"') {
+            offset = skip_string(data, size, offset);
+            continue;
+        } else if (c == '{') {
+            closers.push_back('}');
+        } else if (c == '[') {
+            closers.push_back(']');
+        } else if (c == '}' || c == ']') {
+            if (closers.empty() || closers.back() != c) {
+                throw json_error("unbalanced brackets", offset);
+            }
+
+            closers.pop_back();
+        }
+
+        ++offset;
+    }
+
+    if (!closers.empty()) {
+        throw json_error("unterminated container", size);
+    }
+}
+
+// Walks over elements of an array or members of an object.
+struct cursor_t {
+    cursor_t(const char *data, size_t size) :
+        data(data),
+        size(size),
+        offset(1),
+        closer(data[0] == '{' ? '}' : ']'),
+        first(true)
+    {
+        // pass
+    }
+
+    // Moves to the next element. The key range includes quotes and is left untouched for arrays.
+    bool
+    next(const char *& key, size_t& key_size, const char *& value, size_t& value_size) {
+        offset = skip_space(data, size, offset);
+
+        if (offset >= size) {
+            throw json_error("unterminated container", offset);
+        }
+
+        if (data[offset] == closer) {
+            return false;
+        }
+
+        if (!first) {
+            if (data[offset] != ',') {
+                throw json_error("expected ',' or end of container", offset);
+            }
+
+            offset = skip_space(data, size, offset + 1);
+        }
+
+        first = false;
+
+        if (closer == '}') {
+            if (offset >= size || data[offset] != '"') {
+                throw json_error("expected object key", offset);
+            }
+
+            const size_t end = skip_string(data, size, offset);
+
+            key = data + offset;
+            key_size = end - offset;
+
+            offset = skip_space(data, size, end);
+
+            if (offset >= size || data[offset] != ':') {
+                throw json_error("expected ':'", offset);
+            }
+
+            offset = skip_space(data, size, offset + 1);
+        }
+
+        const size_t end = skip_value(data, size, offset);
+
+        value = data + offset;
+        value_size = end - offset;
+
+        offset = end;
+        return true;
+    }
+
+    const char *data;
+    size_t size;
+    size_t offset;
+    char closer;
+    bool first;
+};
+
+// Event handler which captures a single scalar value.
+struct scalar_t {
+    enum kind_t {
+        null_kind,
+        bool_kind,
+        int_kind,
+        double_kind,
+        string_kind
+    };
+
+    void
+    null_value() {
+        kind = null_kind;
+    }
+
+    void
+    bool_value(dynamic_t::bool_t v) {
+        kind = bool_kind;
+        bool_v = v;
+    }
+
+    void
+    int_value(dynamic_t::int_t v) {
+        kind = int_kind;
+        int_v = v;
+    }
+
+    void
+    double_value(dynamic_t::double_t v) {
+        kind = double_kind;
+        double_v = v;
+    }
+
+    void
+    string_value(const char *data, size_t size) {
+        kind = string_kind;
+        string_v.assign(data, size);
+    }
+
+    void begin_array(size_t) { }
+    void end_array() { }
+    void begin_object(size_t) { }
+    void key(const char *, size_t) { }
+    void end_object() { }
+
+    kind_t kind;
+    dynamic_t::bool_t bool_v;
+    dynamic_t::int_t int_v;
+    dynamic_t::double_t double_v;
+    dynamic_t::string_t string_v;
+};
+
+scalar_t
+decode(const char *data, size_t size) {
+    scalar_t result;
+
+    if (parse_json(data, size, result) != size) {
+        throw json_error("unexpected character", size);
+    }
+
+    return result;
+}
+
+const char null_text[] = "null";
+
+} // namespace
+
+json_view_t::json_view_t() :
+    m_data(null_text),
+    m_size(sizeof(null_text) - 1)
+{
+    // pass
+}
+
+json_view_t::json_view_t(const char *data, size_t size) {
+    size_t begin = skip_space(data, size, 0);
+
+    while (size > begin && is_space(data[size - 1])) {
+        --size;
+    }
+
+    check_structure(data + begin, size - begin);
+
+    if (skip_value(data, size, begin) != size) {
+        throw json_error("unexpected character", skip_value(data, size, begin));
+    }
+
+    m_data = data + begin;
+    m_size = size - begin;
+}
+
+json_view_t::json_view_t(const std::string& text) :
+    json_view_t(text.data(), text.size())
+{
+    // pass
+}
+
+json_view_t::json_view_t(const char *data, size_t size, unchecked_tag) :
+    m_data(data),
+    m_size(size)
+{
+    // pass
+}
+
+bool
+json_view_t::is_null() const {
+    return m_size == 4 && std::memcmp(m_data, "null", 4) == 0;
+}
+
+bool
+json_view_t::is_bool() const {
+    return (m_size == 4 && std::memcmp(m_data, "true", 4) == 0) ||
+           (m_size == 5 && std::memcmp(m_data, "false", 5) == 0);
+}
+
+bool
+json_view_t::is_int() const {
+    return (m_data[0] == '-' || (m_data[0] >= '0' && m_data[0] <= '9')) &&
+           decode(m_data, m_size).kind == scalar_t::int_kind;
+}
+
+bool
+json_view_t::is_double() const {
+    return (m_data[0] == '-' || (m_data[0] >= '0' && m_data[0] <= '9')) &&
+           decode(m_data, m_size).kind == scalar_t::double_kind;
+}
+
+bool
+json_view_t::is_string() const {
+    return m_data[0] == '"';
+}
+
+bool
+json_view_t::is_array() const {
+    return m_data[0] == '[';
+}
+
+bool
+json_view_t::is_object() const {
+    return m_data[0] == '{';
+}
+
+dynamic_t::bool_t
+json_view_t::as_bool() const {
+    if (!is_bool()) {
+        throw boost::bad_get();
+    }
+
+    return m_data[0] == 't';
+}
+
+dynamic_t::int_t
+json_view_t::as_int() const {
+    expect('0');
+
+    const scalar_t value = decode(m_data, m_size);
+
+    if (value.kind != scalar_t::int_kind) {
+        throw boost::bad_get();
+    }
+
+    return value.int_v;
+}
+
+dynamic_t::double_t
+json_view_t::as_double() const {
+    expect('0');
+
+    const scalar_t value = decode(m_data, m_size);
+
+    if (value.kind != scalar_t::double_kind) {
+        throw boost::bad_get();
+    }
+
+    return value.double_v;
+}
+
+dynamic_t::string_t
+json_view_t::as_string() const {
+    expect('"');
+
+    // Fast path: nothing to unescape.
+    if (std::memchr(m_data, '\\', m_size) == nullptr) {
+        return dynamic_t::string_t(m_data + 1, m_size - 2);
+    }
+
+    return decode(m_data, m_size).string_v;
+}
+
+size_t
+json_view_t::size() const {
+    if (!is_array() && !is_object()) {
+        throw boost::bad_get();
+    }
+
+    cursor_t cursor(m_data, m_size);
+
+    const char *key = nullptr, *value = nullptr;
+    size_t key_size = 0, value_size = 0;
+    size_t result = 0;
+
+    while (cursor.next(key, key_size, value, value_size)) {
+        ++result;
+    }
+
+    return result;
+}
+
+json_view_t
+json_view_t::at(size_t index) const {
+    expect('[');
+
+    cursor_t cursor(m_data, m_size);
+
+    const char *key = nullptr, *value = nullptr;
+    size_t key_size = 0, value_size = 0;
+
+    for (size_t i = 0; cursor.next(key, key_size, value, value_size); ++i) {
+        if (i == index) {
+            return json_view_t(value, value_size, unchecked_tag());
+        }
+    }
+
+    throw std::out_of_range("json_view_t::at");
+}
+
+json_view_t
+json_view_t::at(const std::string& key) const {
+    json_view_t result;
+
+    if (!find(key, result)) {
+        throw std::out_of_range("json_view_t::at");
+    }
+
+    return result;
+}
+
+json_view_t
+json_view_t::at(const std::string& key, const json_view_t& def) const {
+    json_view_t result;
+
+    if (!find(key, result)) {
+        return def;
+    }
+
+    return result;
+}
+
+json_view_t
+json_view_t::operator[](size_t index) const {
+    return at(index);
+}
+
+json_view_t
+json_view_t::operator[](const std::string& key) const {
+    return at(key);
+}
+
+dynamic_t
+json_view_t::materialize() const {
+    dynamic_t result;
+    dynamic_builder_t builder(result);
+    parse_json(m_data, m_size, builder);
+    return result;
+}
+
+std::string
+json_view_t::text() const {
+    return std::string(m_data, m_size);
+}
+
+json_view_t::const_iterator
+json_view_t::begin() const {
+    if (!is_array() && !is_object()) {
+        throw boost::bad_get();
+    }
+
+    return const_iterator(*this);
+}
+
+json_view_t::const_iterator
+json_view_t::end() const {
+    return const_iterator();
+}
+
+bool
+json_view_t::find(const std::string& key, json_view_t& result) const {
+    expect('{');
+
+    cursor_t cursor(m_data, m_size);
+
+    const char *raw_key = nullptr, *value = nullptr;
+    size_t raw_key_size = 0, value_size = 0;
+
+    bool found = false;
+
+    // The last occurrence wins if the object has duplicate keys, like in the materialized document,
+    // so the whole object is scanned.
+    while (cursor.next(raw_key, raw_key_size, value, value_size)) {
+        bool equal = false;
+
+        if (std::memchr(raw_key, '\\', raw_key_size) == nullptr) {
+            equal = raw_key_size - 2 == key.size() && std::memcmp(raw_key + 1, key.data(), key.size()) == 0;
+        } else {
+            equal = decode(raw_key, raw_key_size).string_v == key;
+        }
+
+        if (equal) {
+            result = json_view_t(value, value_size, unchecked_tag());
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+// Throws boost::bad_get if the value doesn't start with the character ('0' stands for any number).
+void
+json_view_t::expect(char c) const {
+    const char first = m_data[0];
+
+    if (c == '0' ? (first != '-' && (first < '0' || first > '9')) : first != c) {
+        throw boost::bad_get();
+    }
+}
+
+json_view_t::const_iterator::const_iterator() :
+    m_container(nullptr),
+    m_size(0),
+    m_offset(0),
+    m_key(nullptr),
+    m_key_size(0)
+{
+    // pass
+}
+
+json_view_t::const_iterator::const_iterator(const json_view_t& container) :
+    m_container(container.m_data),
+    m_size(container.m_size),
+    m_offset(0),
+    m_key(nullptr),
+    m_key_size(0)
+{
+    ++*this;
+}
+
+std::string
+json_view_t::const_iterator::key() const {
+    if (!m_key) {
+        return std::string();
+    }
+
+    if (std::memchr(m_key, '\\', m_key_size) == nullptr) {
+        return std::string(m_key + 1, m_key_size - 2);
+    }
+
+    return decode(m_key, m_key_size).string_v;
+}
+
+json_view_t::const_iterator&
+json_view_t::const_iterator::operator++() {
+    // The cursor resumes right after the current element, or starts over before the first one.
+    cursor_t cursor(m_container, m_size);
+
+    if (m_offset != 0) {
+        cursor.offset = m_offset;
+        cursor.first = false;
+    }
+
+    const char *value = nullptr;
+    size_t value_size = 0;
+
+    if (!cursor.next(m_key, m_key_size, value, value_size)) {
+        *this = const_iterator();
+        return *this;
+    }
+
+    m_offset = cursor.offset;
+    m_value = json_view_t(value, value_size, unchecked_tag());
+
+    return *this;
+}
+
+json_view_t::const_iterator
+json_view_t::const_iterator::operator++(int) {
+    const_iterator result(*this);
+    ++*this;
+    return result;
+}
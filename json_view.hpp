@@ -0,0 +1,180 @@
+#ifndef COCAINE_DYNAMIC_JSON_VIEW_HPP
+#define COCAINE_DYNAMIC_JSON_VIEW_HPP
+
+#include "dynamic.hpp"
+#include "json.hpp"
+
+#include <iterator>
+#include <string>
+
+namespace cocaine { namespace io {
+
+// Read-only view of a JSON document which decodes values only when they are accessed.
+// Constructing the root view checks that strings are terminated and brackets are balanced,
+// everything else (numbers, escapes, nested containers) is decoded on demand, so handlers
+// which touch a few fields don't pay for the whole document.
+// The view doesn't own the text, it must outlive all views into it.
+// Type mismatches throw boost::bad_get like dynamic_t does, malformed JSON throws json_error.
+// Of duplicate keys the last one wins, just like in the materialized document.
+class json_view_t {
+public:
+    class const_iterator;
+
+public:
+    json_view_t();
+
+    json_view_t(const char *data, size_t size);
+
+    explicit
+    json_view_t(const std::string& text);
+
+    bool
+    is_null() const;
+
+    bool
+    is_bool() const;
+
+    bool
+    is_int() const;
+
+    bool
+    is_double() const;
+
+    bool
+    is_string() const;
+
+    bool
+    is_array() const;
+
+    bool
+    is_object() const;
+
+    dynamic_t::bool_t
+    as_bool() const;
+
+    dynamic_t::int_t
+    as_int() const;
+
+    dynamic_t::double_t
+    as_double() const;
+
+    dynamic_t::string_t
+    as_string() const;
+
+    // Number of elements of an array or members of an object, duplicate keys included.
+    // Scans the whole container.
+    size_t
+    size() const;
+
+    // Elements of an array or values of the members of an object in the order of the text.
+    // Walking the container with iterators takes a single scan, unlike indexing it with at().
+    const_iterator
+    begin() const;
+
+    const_iterator
+    end() const;
+
+    // Element of an array. Throws std::out_of_range if there is no such element.
+    // Scans the array up to the element.
+    json_view_t
+    at(size_t index) const;
+
+    // Member of an object. Throws std::out_of_range if there is no such key.
+    json_view_t
+    at(const std::string& key) const;
+
+    json_view_t
+    at(const std::string& key, const json_view_t& def) const;
+
+    json_view_t
+    operator[](size_t index) const;
+
+    json_view_t
+    operator[](const std::string& key) const;
+
+    // Decodes the whole subtree.
+    dynamic_t
+    materialize() const;
+
+    // Raw JSON text of the value.
+    std::string
+    text() const;
+
+private:
+    struct unchecked_tag { };
+
+    json_view_t(const char *data, size_t size, unchecked_tag);
+
+    friend class const_iterator;
+
+    // Finds a member of an object, returns false if there is none.
+    bool
+    find(const std::string& key, json_view_t& result) const;
+
+    void
+    expect(char c) const;
+
+private:
+    const char *m_data;
+    size_t m_size;
+};
+
+class json_view_t::const_iterator :
+    public std::iterator<std::forward_iterator_tag, const json_view_t>
+{
+public:
+    // The end iterator.
+    const_iterator();
+
+    const json_view_t&
+    operator*() const {
+        return m_value;
+    }
+
+    const json_view_t*
+    operator->() const {
+        return &m_value;
+    }
+
+    // Key of the current member of an object, an empty string for arrays.
+    std::string
+    key() const;
+
+    const_iterator&
+    operator++();
+
+    const_iterator
+    operator++(int);
+
+    bool
+    operator==(const const_iterator& other) const {
+        return m_container == other.m_container && m_offset == other.m_offset;
+    }
+
+    bool
+    operator!=(const const_iterator& other) const {
+        return !(*this == other);
+    }
+
+private:
+    friend class json_view_t;
+
+    explicit
+    const_iterator(const json_view_t& container);
+
+private:
+    // Null for the end iterator.
+    const char *m_container;
+    size_t m_size;
+
+    // State of the scan: the offset right after the current element.
+    size_t m_offset;
+
+    const char *m_key;
+    size_t m_key_size;
+    json_view_t m_value;
+};
+
+}} // namespace cocaine::io
+
+#endif // COCAINE_DYNAMIC_JSON_VIEW_HPP
@@ -1,5 +1,12 @@
 #include <iostream>
+#include <sstream>
+#include <unordered_set>
+#include <limits>
+#include <ctime>
+#include <cstdio>
 #include <cassert>
+#include <chrono>
+#include <numeric>
 
 #include <cocaine/framework/common.hpp>
 
@@ -7,6 +14,25 @@
 
 #include "dynamic.hpp"
 #include "traits.hpp"
+#include "reader.hpp"
+#include "transcode.hpp"
+#include "json_view.hpp"
+#include "compact.hpp"
+#include "mapped.hpp"
+#include "path.hpp"
+#include "dedup.hpp"
+#include "patch.hpp"
+#include "merge.hpp"
+#include "traverse.hpp"
+#include "parallel.hpp"
+#include "query.hpp"
+#include "index.hpp"
+#include "reflect.hpp"
+#include "numeric.hpp"
+#include "builder.hpp"
+#include "snapshot.hpp"
+#include "concurrent.hpp"
+#include "reclaim.hpp"
 
 using namespace cocaine;
 
@@ -114,167 +140,2633 @@ test_msgpack() {
     assert(d1 == d2);
 }
 
+void
+test_reader() {
+    dynamic_t::array_t records;
+    for (int i = 0; i < 20; ++i) {
+        dynamic_t record;
+        record.as_object()["id"] = i;
+        record.as_object()["name"] = std::string(i, 'x');
+        records.push_back(record);
+    }
+
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(buffer);
+    cocaine::io::type_traits<dynamic_t>::pack(packer, dynamic_t(records));
+
+    cocaine::io::dynamic_reader_t reader;
+    dynamic_t::array_t result;
+
+    // Feed the stream in tiny chunks to make sure elements are split between them.
+    for (size_t offset = 0; offset < buffer.size(); offset += 3) {
+        reader.feed(buffer.data() + offset, std::min<size_t>(3, buffer.size() - offset));
+
+        dynamic_t element;
+        while (reader.next(element)) {
+            result.push_back(element);
+        }
+    }
+
+    assert(reader.container() == cocaine::io::dynamic_reader_t::array);
+    assert(reader.size() == 20);
+    assert(reader.done());
+    assert(result == records);
+
+    dynamic_t::object_t object;
+    object["a"] = 1;
+    object["b"] = records;
+    object["c"] = "str";
+
+    msgpack::sbuffer map_buffer;
+    msgpack::packer<msgpack::sbuffer> map_packer(map_buffer);
+    cocaine::io::type_traits<dynamic_t>::pack(map_packer, dynamic_t(object));
+
+    cocaine::io::dynamic_reader_t map_reader;
+    dynamic_t::object_t map_result;
+
+    for (size_t offset = 0; offset < map_buffer.size(); ++offset) {
+        map_reader.feed(map_buffer.data() + offset, 1);
+
+        std::string key;
+        dynamic_t value;
+        while (map_reader.next(key, value)) {
+            map_result[key] = value;
+        }
+    }
+
+    assert(map_reader.container() == cocaine::io::dynamic_reader_t::map);
+    assert(map_reader.done());
+    assert(map_result == object);
+
+    // The array32 header of two elements split between feeds.
+    const char header[] = { '\xdd', 0, 0, 0, 2, 1, 2 };
+
+    cocaine::io::dynamic_reader_t split_reader;
+    split_reader.feed(header, 2);
+
+    dynamic_t element;
+    assert(!split_reader.next(element));
+    assert(split_reader.container() == cocaine::io::dynamic_reader_t::unknown);
+
+    std::string key;
+    assert(!split_reader.next(key, element));
+
+    split_reader.feed(header + 2, 4);
+    assert(split_reader.container() == cocaine::io::dynamic_reader_t::array);
+    assert(split_reader.size() == 2);
+    assert(split_reader.next(element) && element == 1);
+    assert(!split_reader.next(element));
+
+    split_reader.feed(header + 6, 1);
+    assert(split_reader.next(element) && element == 2);
+    assert(split_reader.done());
+}
+
+void
+test_transcode() {
+    dynamic_t d1;
+    auto& obj = d1.as_object();
+    obj["a"] = std::make_tuple(1, 2.5, std::string("x\n\"y\""));
+    obj["b"] = dynamic_t();
+    obj["c"] = true;
+    obj["d"] = -100000;
+    obj["e"] = 3.0;
+    obj["f"].as_object()["g"] = dynamic_t::array_t();
+    obj["f"].as_object()["h"] = dynamic_t::object_t();
+
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(buffer);
+    cocaine::io::type_traits<dynamic_t>::pack(packer, d1);
+
+    std::ostringstream json;
+    assert(cocaine::io::msgpack_to_json(buffer.data(), buffer.size(), json) == buffer.size());
+    assert(json.str() == "{\"a\":[1,2.5,\"x\\n\\\"y\\\"\"],\"b\":null,\"c\":true,\"d\":-100000,"
+                         "\"e\":3.0,\"f\":{\"g\":[],\"h\":{}}}");
+
+    std::ostringstream emitted;
+    cocaine::io::json_writer_t<std::ostringstream> writer(emitted);
+    emit(d1, writer);
+    assert(emitted.str() == json.str());
+
+    msgpack::sbuffer transcoded;
+    cocaine::io::json_to_msgpack(json.str().data(), json.str().size(), transcoded);
+
+    dynamic_t d2 = cocaine::framework::unpack<dynamic_t>(transcoded.data(), transcoded.size());
+    assert(d1 == d2);
+
+    const std::string text = " [ {\"k\" : \"\\u00e9\\ud83d\\ude00\"}, [[]], 1e2, -0.5 ] ";
+    msgpack::sbuffer unicode;
+    assert(cocaine::io::json_to_msgpack(text.data(), text.size(), unicode) == text.size());
+
+    dynamic_t d3 = cocaine::framework::unpack<dynamic_t>(unicode.data(), unicode.size());
+    assert(d3.as_array().size() == 4);
+    assert(d3.as_array()[0].as_object()["k"] == "\xc3\xa9\xf0\x9f\x98\x80");
+    assert(d3.as_array()[1].as_array()[0].as_array().empty());
+    assert(d3.as_array()[2] == 100.0);
+    assert(d3.as_array()[3] == -0.5);
+
+    bool failed = false;
+    try {
+        msgpack::sbuffer broken;
+        cocaine::io::json_to_msgpack("[1, 2", 5, broken);
+    } catch (const cocaine::io::json_error&) {
+        failed = true;
+    }
+    assert(failed);
+}
+
+void
+test_json_view() {
+    const std::string text = "{ \"id\": 17, \"name\": \"a\\\"b\", \"ratio\": 0.5, \"ok\": true,"
+                             "  \"tags\": [\"x\", null, [1, 2]], \"broken\": [1x], \"e\\u0073c\": {} }";
+
+    cocaine::io::json_view_t view(text);
+
+    assert(view.is_object());
+    assert(view.size() == 7);
+    assert(view.at("id").is_int());
+    assert(view.at("id").as_int() == 17);
+    assert(view["name"].as_string() == "a\"b");
+    assert(view["ratio"].is_double());
+    assert(view["ratio"].as_double() == 0.5);
+    assert(view["ok"].as_bool());
+    assert(view["tags"].size() == 3);
+    assert(view["tags"][1].is_null());
+    assert(view["tags"][2][1].as_int() == 2);
+    assert(view["esc"].is_object());
+    assert(view.at("missing", cocaine::io::json_view_t()).is_null());
+
+    // Malformed values are reported only when they're accessed.
+    assert(view["broken"].size() == 1);
+
+    bool failed = false;
+    try {
+        view["broken"][0].as_int();
+    } catch (const cocaine::io::json_error&) {
+        failed = true;
+    }
+    assert(failed);
+
+    failed = false;
+    try {
+        view["id"].as_string();
+    } catch (const boost::bad_get&) {
+        failed = true;
+    }
+    assert(failed);
+
+    failed = false;
+    try {
+        cocaine::io::json_view_t("{\"a\": [1, 2}");
+    } catch (const cocaine::io::json_error&) {
+        failed = true;
+    }
+    assert(failed);
+
+    dynamic_t tags = view["tags"].materialize();
+    assert(tags.as_array().size() == 3);
+    assert(tags.as_array()[0] == "x");
+    assert(tags.as_array()[1].is_null());
+    assert(tags.as_array()[2].to<std::vector<int>>()[0] == 1);
+
+    msgpack::sbuffer buffer;
+    cocaine::io::json_to_msgpack(view["tags"].text().data(), view["tags"].text().size(), buffer);
+    assert(tags == cocaine::framework::unpack<dynamic_t>(buffer.data(), buffer.size()));
+
+    // Iterators walk the elements in a single scan.
+    const std::string numbers_text = "[10, 11, [12], 13]";
+    cocaine::io::json_view_t numbers(numbers_text);
+    size_t index = 0;
+    for (auto it = numbers.begin(); it != numbers.end(); ++it, ++index) {
+        assert(it->text() == numbers.at(index).text());
+        assert(it.key().empty());
+    }
+    assert(index == numbers.size());
+    const std::string empty_text = "[]";
+    cocaine::io::json_view_t empty(empty_text);
+    assert(empty.begin() == empty.end());
+
+    // Duplicate keys resolve to the last occurrence both in the view and in the materialized document.
+    const std::string duplicates_text = "{\"a\": 1, \"b\\u0021\": 2, \"a\": 3}";
+    cocaine::io::json_view_t duplicates(duplicates_text);
+    assert(duplicates.at("a").as_int() == 3);
+    assert(duplicates.materialize().as_object().at("a") == 3);
+
+    std::vector<std::string> keys;
+    for (auto it = duplicates.begin(); it != duplicates.end(); it++) {
+        keys.push_back(it.key());
+    }
+    assert((keys == std::vector<std::string>({"a", "b!", "a"})));
+}
+
+void
+test_compact() {
+    dynamic_t d1;
+    auto& records = d1.as_object()["records"].as_array();
+    for (int i = 0; i < 50; ++i) {
+        dynamic_t record;
+        record.as_object()["identifier"] = i - 25;
+        record.as_object()["description"] = std::string(i % 7, 'z');
+        record.as_object()["weight"] = i * 0.25;
+        record.as_object()["enabled"] = i % 2 == 0;
+        record.as_object()["children"] = dynamic_t::array_t(2);
+        records.push_back(record);
+    }
+    d1.as_object()["min"] = std::numeric_limits<dynamic_t::int_t>::min();
+    d1.as_object()["max"] = std::numeric_limits<dynamic_t::int_t>::max();
+
+    std::string encoded = cocaine::io::compact_encode(d1);
+    dynamic_t d2 = cocaine::io::compact_decode(encoded);
+    assert(d1 == d2);
+
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(buffer);
+    cocaine::io::type_traits<dynamic_t>::pack(packer, d1);
+    assert(encoded.size() < buffer.size());
+
+    bool failed = false;
+    try {
+        cocaine::io::compact_decode(encoded.data(), encoded.size() - 1);
+    } catch (const cocaine::io::compact_error&) {
+        failed = true;
+    }
+    assert(failed);
+
+    // Nesting is limited, so malicious input can't overflow the stack.
+    dynamic_t deep;
+    dynamic_t *innermost = &deep;
+    for (size_t i = 0; i < cocaine::io::compact_max_depth; ++i) {
+        innermost->as_array().emplace_back();
+        innermost = &innermost->as_array().back();
+    }
+    assert(cocaine::io::compact_decode(cocaine::io::compact_encode(deep)) == deep);
+
+    // Repeated and unordered keys are malformed, a repeated key must not overwrite a member the deduplicator holds.
+    const std::string value = std::string("\x06\x01\x05\x14", 4) + std::string(20, 's');
+    const std::string repeated = std::string("\x07\x03\x00\x01" "a", 5) + value +
+                                 std::string("\x01\x00\x01", 3) + value;
+    const std::string unordered = std::string("\x07\x02\x00\x01" "b\x00\x00\x01" "a\x00", 10);
+
+    for (int i = 0; i < 2; ++i) {
+        const std::string& malformed = i == 0 ? repeated : unordered;
+
+        failed = false;
+        try {
+            deduplicator_t deduplicator;
+            cocaine::io::compact_decode(malformed.data(), malformed.size(), deduplicator);
+        } catch (const cocaine::io::compact_error&) {
+            failed = true;
+        }
+        assert(failed);
+
+        failed = false;
+        try {
+            cocaine::io::compact_decode(malformed);
+        } catch (const cocaine::io::compact_error&) {
+            failed = true;
+        }
+        assert(failed);
+    }
+
+    std::string nested;
+    for (int i = 0; i < 100000; ++i) {
+        nested.append("\x06\x01");
+    }
+    nested.push_back('\0');
+
+    failed = false;
+    try {
+        cocaine::io::compact_decode(nested);
+    } catch (const cocaine::io::compact_error&) {
+        failed = true;
+    }
+    assert(failed);
+}
+
+void
+test_mapped() {
+    dynamic_t d1;
+    auto& obj = d1.as_object();
+    obj["int"] = -42;
+    obj["double"] = 2.5;
+    obj["bool"] = true;
+    obj["null"] = dynamic_t();
+    obj["string"] = "value";
+    obj["list"] = std::make_tuple(1, std::string("two"), 3.0);
+    for (int i = 0; i < 100; ++i) {
+        obj["nested"].as_object()["key" + std::to_string(i)].as_object()["key" + std::to_string(i)] = i;
+    }
+
+    const std::string path = "/tmp/dynamic_mapped_test.bin";
+    cocaine::io::mapped_write(d1, path);
+
+    cocaine::io::mapped_file_t file(path);
+    cocaine::io::mapped_view_t root = file.root();
+
+    assert(root.is_object());
+    assert(root.size() == 7);
+    assert(root["int"].as_int() == -42);
+    assert(root["double"].as_double() == 2.5);
+    assert(root["bool"].as_bool());
+    assert(root["null"].is_null());
+    assert(root["string"].as_string() == std::string("value"));
+    assert(root["string"].size() == 5);
+    assert(root["list"].size() == 3);
+    assert(root["list"][1].as_string() == std::string("two"));
+    assert(root["nested"]["key57"]["key57"].as_int() == 57);
+    assert(root["nested"].at("key100", root["null"]).is_null());
+    assert(root.key_at(0) == std::string("bool"));
+
+    bool failed = false;
+    try {
+        root["nested"]["missing"];
+    } catch (const std::out_of_range&) {
+        failed = true;
+    }
+    assert(failed);
+
+    failed = false;
+    try {
+        root["int"].as_string();
+    } catch (const boost::bad_get&) {
+        failed = true;
+    }
+    assert(failed);
+
+    assert(root.materialize() == d1);
+    assert(root["nested"]["key3"].materialize() == obj["nested"].as_object()["key3"]);
+
+    std::remove(path.c_str());
+}
+
+void
+test_path() {
+    dynamic_t d1;
+    auto& obj = d1.as_object();
+    obj["a"].as_object()["b"] = std::vector<int>(3, 7);
+    obj["a"].as_object()["c/d"] = "slash";
+    obj["a"].as_object()["e~f"] = "tilde";
+    obj["a"].as_object()["0"] = "zero";
+
+    const path_t path("/a/b/1");
+    assert(path.size() == 3);
+    assert(path.get(d1) && *path.get(d1) == 7);
+    assert(path_t("/a/c~1d").get_or(d1, 0) == "slash");
+    assert(path_t("/a/e~0f").get_or(d1, 0) == "tilde");
+    assert(path_t("/a/0").get_or(d1, 0) == "zero");
+    assert(path_t("").get(d1) == &d1);
+
+    assert(!path_t("/a/b/3").get(d1));
+    assert(!path_t("/a/b/x").get(d1));
+    assert(!path_t("/a/b/01").get(d1));
+    assert(!path_t("/missing/key").get(d1));
+    assert(path_t("/a/b/5/c").get_or(d1, "default") == "default");
+
+    path_t("/x/y/0/z").set(d1, 5);
+    path_t("/x/y/1").set(d1, 6);
+    assert(obj["x"].as_object()["y"].as_array().size() == 2);
+    assert(obj["x"].as_object()["y"].as_array()[0].as_object()["z"] == 5);
+    assert(obj["x"].as_object()["y"].as_array()[1] == 6);
+
+    bool failed = false;
+    try {
+        path_t("/x/y/3").set(d1, 7);
+    } catch (const path_error&) {
+        failed = true;
+    }
+    assert(failed);
+    assert(obj["x"].as_object()["y"].as_array().size() == 2);
+
+    path_t("/a/b/-").set(d1, 8);
+    assert(obj["a"].as_object()["b"].as_array().size() == 4);
+    assert(obj["a"].as_object()["b"].as_array()[3] == 8);
+
+    path_t("/a/b/0").ensure(d1) = 9;
+    assert(obj["a"].as_object()["b"].as_array()[0] == 9);
+
+    failed = false;
+    try {
+        path_t("/a/c~1d/x").ensure(d1);
+    } catch (const boost::bad_get&) {
+        failed = true;
+    }
+    assert(failed);
+
+    assert(path_t("/a/b/0").erase(d1));
+    assert(obj["a"].as_object()["b"].as_array().size() == 3);
+    assert(path_t("/a/c~1d").erase(d1));
+    assert(!path_t("/a/c~1d").erase(d1));
+
+    assert(path_t("/a/c~1d/e~0f").to_string() == "/a/c~1d/e~0f");
+    assert(path_t().append("a/b").append(3) == path_t("/a~1b/3"));
+    assert(path_t("/a/b").parent() == path_t("/a"));
+
+    failed = false;
+    try {
+        path_t("a/b");
+    } catch (const path_error&) {
+        failed = true;
+    }
+    assert(failed);
+}
+
+void
+test_hash() {
+    dynamic_t d1;
+    d1.as_object()["a"] = 1;
+    d1.as_object()["b"] = std::make_tuple(0.0, std::string("x"), false);
+    d1.as_object()["c"].as_object()["d"] = dynamic_t();
+
+    dynamic_t d2;
+    d2.as_object()["c"].as_object()["d"] = dynamic_t();
+    d2.as_object()["b"] = std::make_tuple(-0.0, std::string("x"), false);
+    d2.as_object()["a"] = 1;
+
+    assert(d1 == d2);
+    assert(d1.hash() == d2.hash());
+    assert(std::hash<dynamic_t>()(d1) == hash_value(d2));
+
+    assert(dynamic_t(1).hash() != dynamic_t(1.0).hash());
+    assert(dynamic_t(std::vector<int>{1, 2}).hash() != dynamic_t(std::vector<int>{2, 1}).hash());
+
+    std::unordered_set<dynamic_t> set;
+    set.insert(d1);
+    set.insert(d2);
+    set.insert(1);
+    set.insert(1.0);
+    set.insert("1");
+    assert(set.size() == 4);
+    assert(set.count(d2) == 1);
+
+    // Mutable access drops hashes cached along the way.
+    const std::size_t before = d1.hash();
+    d1.as_object()["c"].as_object()["d"] = 5;
+    assert(d1.hash() != before);
+    assert(d1 != d2);
+
+    d2.as_object()["c"].as_object()["d"] = 5;
+    assert(d1.hash() == d2.hash());
+    assert(d1 == d2);
+
+    dynamic_t d3 = d1;
+    assert(d3 == d1);
+    d3.as_object()["a"] = 2;
+    assert(d3 != d1);
+    assert(d3.hash() != d1.hash());
+
+    // Changes through references taken before hashing are seen too, at the top level and deeper.
+    dynamic_t held = dynamic_t::object_t();
+    dynamic_t::object_t& members = held.as_object();
+    dynamic_t::array_t& nested = members["nested"].as_array();
+    const std::size_t empty = held.hash();
+
+    members["x"] = 2;
+    nested.push_back(1);
+
+    dynamic_t rebuilt = dynamic_t::object_t();
+    rebuilt.as_object()["x"] = 2;
+    rebuilt.as_object()["nested"] = std::vector<int>({1});
+
+    assert(held.hash() != empty);
+    assert(held.hash() == rebuilt.hash());
+    assert(held == rebuilt);
+}
+
+void
+test_dedup() {
+    dynamic_t limits;
+    limits.as_object()["memory"] = 1024;
+    limits.as_object()["description"] = std::string("a description which doesn't fit into std::string");
+    limits.as_object()["hosts"] = std::vector<std::string>{"first", "second"};
+
+    dynamic_t config;
+    for (int i = 0; i < 10; ++i) {
+        dynamic_t service;
+        service.as_object()["id"] = i;
+        service.as_object()["limits"] = limits;
+        config.as_array().push_back(service);
+    }
+
+    const dynamic_t original = config;
+    assert(dedup(config) > 0);
+    assert(config == original);
+
+    const dynamic_t::array_t& services = config.as_array();
+    assert(services[1].as_object()["limits"].is_shared());
+    assert(&services[0].as_object()["limits"].as_object() == &services[9].as_object()["limits"].as_object());
+    assert(services[9].as_object()["limits"].as_object()["hosts"].as_array()[1].as_string() == "second");
+
+    // Mutable access detaches a private copy, the other services keep the shared one.
+    dynamic_t::object_t& own = config.as_array()[3].as_object()["limits"].as_object();
+    own["memory"] = 2048;
+    assert(!config.as_array()[3].as_object()["limits"].is_shared());
+    assert(config.as_array()[4].as_object()["limits"].as_object()["memory"] == 1024);
+    assert(config != original);
+
+    dynamic_t copy = config;
+    assert(copy == config);
+    copy.as_array()[4].as_object()["limits"].as_object()["memory"] = 0;
+    assert(config.as_array()[4].as_object()["limits"].as_object()["memory"] == 1024);
+
+    // Paths and patches detach the shared nodes they change too.
+    dynamic_t services_config = original;
+    dedup(services_config);
+
+    assert(path_t("/5/limits/hosts").erase(services_config));
+    *path_t("/6/limits/memory").get(services_config) = 42;
+
+    dynamic_t operation = dynamic_t::object_t();
+    operation.as_object()["op"] = std::string("replace");
+    operation.as_object()["path"] = std::string("/7/limits/description");
+    operation.as_object()["value"] = std::string("patched");
+    apply_patch(services_config, std::vector<dynamic_t>({operation}));
+
+    const dynamic_t::array_t& changed = services_config.as_array();
+    assert(!changed[5].as_object().at("limits").as_object().count("hosts"));
+    assert(changed[6].as_object().at("limits").as_object().at("memory") == 42);
+    assert(changed[7].as_object().at("limits").as_object().at("description") == "patched");
+
+    for (size_t i = 0; i < changed.size(); ++i) {
+        if (i < 5 || i > 7) {
+            assert(changed[i] == original.as_array()[i]);
+        }
+    }
+
+    // Decoding shares subtrees with the previous documents.
+    const std::string encoded = io::compact_encode(original);
+    deduplicator_t deduplicator;
+    const dynamic_t first = io::compact_decode(encoded.data(), encoded.size(), deduplicator);
+    const dynamic_t second = io::compact_decode(encoded.data(), encoded.size(), deduplicator);
+    assert(first == original);
+    assert(second == original);
+    assert(deduplicator.shared() > 0);
+    assert(deduplicator.reclaimed() > deduplicator.overhead());
+    assert(&first.as_array()[0].as_object()["limits"].as_object() == &second.as_array()[5].as_object()["limits"].as_object());
+}
+
+void
+test_patch() {
+    dynamic_t from;
+    from.as_object()["name"] = "app";
+    from.as_object()["a/b"] = 1;
+    from.as_object()["list"] = std::vector<int>{1, 2, 3, 4, 5};
+    from.as_object()["nested"].as_object()["x"] = 1;
+    from.as_object()["nested"].as_object()["y"] = 2;
+    from.as_object()["removed"] = true;
+
+    dynamic_t to = from;
+    to.as_object()["a/b"] = 2;
+    to.as_object()["list"] = std::vector<int>{1, 2, 10, 11, 4, 5};
+    to.as_object()["nested"].as_object()["y"] = std::string("two");
+    to.as_object()["added"] = dynamic_t::object_t();
+    to.as_object().erase("removed");
+
+    dynamic_t patch = diff(from, to);
+    assert(patch.as_array().size() == 6);
+    assert(patch.as_array()[0].as_object()["op"] == "replace");
+    assert(patch.as_array()[0].as_object()["path"] == "/a~1b");
+
+    dynamic_t target = from;
+    apply_patch(target, patch);
+    assert(target == to);
+
+    target = from;
+    apply_patch(target, std::move(patch));
+    assert(target == to);
+
+    assert(diff(to, to).as_array().empty());
+    assert(diff(from, 5).as_array().size() == 1);
+
+    dynamic_t shorter = from;
+    shorter.as_object()["list"] = std::vector<int>{1, 5};
+    target = from;
+    apply_patch(target, diff(from, shorter));
+    assert(target == shorter);
+
+    // Operations which diff() doesn't produce.
+    dynamic_t operations = dynamic_t::array_t();
+    operations.as_array().push_back(dynamic_t::object_t());
+    operations.as_array().back().as_object()["op"] = "move";
+    operations.as_array().back().as_object()["from"] = "/nested/x";
+    operations.as_array().back().as_object()["path"] = "/list/-";
+    operations.as_array().push_back(dynamic_t::object_t());
+    operations.as_array().back().as_object()["op"] = "copy";
+    operations.as_array().back().as_object()["from"] = "/name";
+    operations.as_array().back().as_object()["path"] = "/nested/name";
+    operations.as_array().push_back(dynamic_t::object_t());
+    operations.as_array().back().as_object()["op"] = "test";
+    operations.as_array().back().as_object()["path"] = "/list/5";
+    operations.as_array().back().as_object()["value"] = 1;
+
+    target = from;
+    apply_patch(target, operations);
+    assert(target.as_object()["list"].as_array().size() == 6);
+    assert(target.as_object()["nested"].as_object()["name"] == "app");
+    assert(target.as_object()["nested"].as_object().count("x") == 0);
+
+    bool failed = false;
+    try {
+        apply_patch(target, operations);
+    } catch (const patch_error&) {
+        failed = true;
+    }
+    assert(failed);
+
+    // Failed moves leave the source in place.
+    const dynamic_t before = target;
+    const std::string destinations[] = { "/missing/x", "/name/0", "/list/6" };
+
+    for (size_t i = 0; i < sizeof(destinations) / sizeof(destinations[0]); ++i) {
+        dynamic_t move = dynamic_t::array_t(1);
+        move.as_array()[0].as_object()["op"] = "move";
+        move.as_array()[0].as_object()["from"] = "/list/1";
+        move.as_array()[0].as_object()["path"] = destinations[i];
+
+        failed = false;
+        try {
+            apply_patch(target, move);
+        } catch (const patch_error&) {
+            failed = true;
+        }
+        assert(failed);
+        assert(target == before);
+    }
+
+    // Merge patch example from RFC 7396.
+    dynamic_t document;
+    document.as_object()["title"] = "Goodbye!";
+    document.as_object()["author"].as_object()["givenName"] = "John";
+    document.as_object()["author"].as_object()["familyName"] = "Doe";
+    document.as_object()["tags"] = std::vector<std::string>{"example", "sample"};
+
+    dynamic_t merge;
+    merge.as_object()["title"] = "Hello!";
+    merge.as_object()["phoneNumber"] = "+01-123-456-7890";
+    merge.as_object()["author"].as_object()["familyName"] = dynamic_t();
+    merge.as_object()["tags"] = std::vector<std::string>{"example"};
+
+    apply_merge_patch(document, merge);
+    assert(document.as_object()["title"] == "Hello!");
+    assert(document.as_object()["author"].as_object().size() == 1);
+    assert(document.as_object()["tags"].as_array().size() == 1);
+
+    apply_merge_patch(document, std::move(merge));
+    assert(document.as_object()["phoneNumber"] == "+01-123-456-7890");
+}
+
+void
+test_merge() {
+    dynamic_t defaults;
+    defaults.as_object()["port"] = 8080;
+    defaults.as_object()["hosts"] = std::vector<std::string>{"a", "b"};
+    defaults.as_object()["limits"].as_object()["memory"] = 1024;
+    defaults.as_object()["limits"].as_object()["cpu"] = 1;
+
+    dynamic_t host;
+    host.as_object()["hosts"] = std::vector<std::string>{"b", "c"};
+    host.as_object()["limits"].as_object()["memory"] = 2048;
+    host.as_object()["logging"].as_object()["level"] = "debug";
+
+    dynamic_t replaced = defaults;
+    merge(replaced, host);
+    assert(replaced.as_object()["port"] == 8080);
+    assert(replaced.as_object()["hosts"] == host.as_object()["hosts"]);
+    assert(replaced.as_object()["limits"].as_object()["memory"] == 2048);
+    assert(replaced.as_object()["limits"].as_object()["cpu"] == 1);
+    assert(replaced.as_object()["logging"] == host.as_object()["logging"]);
+
+    dynamic_t appended = defaults;
+    merge(appended, host, array_merge_t::append);
+    assert(appended.as_object()["hosts"] == std::vector<std::string>({"a", "b", "c"}));
+
+    dynamic_t concatenated = defaults;
+    merge(concatenated, host, array_merge_t::concat);
+    assert(concatenated.as_object()["hosts"] == std::vector<std::string>({"a", "b", "b", "c"}));
+
+    // Subtrees are stolen from the rvalue overlay.
+    const dynamic_t *level = &host.as_object()["logging"].as_object()["level"];
+    dynamic_t stolen = defaults;
+    merge(stolen, std::move(host));
+    assert(stolen == replaced);
+    assert(&stolen.as_object()["logging"].as_object()["level"] == level);
+
+    dynamic_t empty;
+    merge(empty, defaults);
+    assert(empty == defaults);
+
+    merge(empty, 5);
+    assert(empty == 5);
+}
+
+struct path_collector :
+    public traversal_visitor_t
+{
+    traversal_t::action_t
+    enter(const dynamic_t& node, const traversal_t& traversal) {
+        m_events.push_back("enter " + traversal.path().to_string());
+        return node.is_object() && node.as_object().count("skip") ? traversal_t::skip : traversal_t::proceed;
+    }
+
+    traversal_t::action_t
+    leave(const dynamic_t&, const traversal_t& traversal) {
+        m_events.push_back("leave " + traversal.path().to_string());
+        return traversal_t::proceed;
+    }
+
+    traversal_t::action_t
+    leaf(const dynamic_t& node, const traversal_t& traversal) {
+        m_events.push_back("leaf " + traversal.path().to_string());
+        return node == "stop" ? traversal_t::stop : traversal_t::proceed;
+    }
+
+    std::vector<std::string> m_events;
+};
+
+void
+test_traverse() {
+    dynamic_t d;
+    d.as_object()["a"] = std::vector<int>{1, 2};
+    d.as_object()["b"].as_object()["skip"] = true;
+    d.as_object()["c"] = dynamic_t::array_t();
+    d.as_object()["d"] = 5;
+
+    path_collector collector;
+    assert(traverse(d, collector));
+
+    const std::vector<std::string> expected = {
+        "enter ", "enter /a", "leaf /a/0", "leaf /a/1", "leave /a", "enter /b", "enter /c", "leave /c", "leaf /d", "leave "
+    };
+    assert(collector.m_events == expected);
+
+    d.as_object()["a"].as_array()[1] = "stop";
+    path_collector stopped;
+    assert(!traverse(d, stopped));
+    assert(stopped.m_events.back() == "leaf /a/1");
+
+    path_collector scalar;
+    assert(traverse(5, scalar));
+    assert(scalar.m_events == std::vector<std::string>{"leaf "});
+
+    // Deep documents don't grow the call stack.
+    dynamic_t deep;
+    dynamic_t *node = &deep;
+    for (int i = 0; i < 10000; ++i) {
+        node->as_array().emplace_back();
+        node = &node->as_array().back();
+    }
+
+    struct depth_visitor :
+        public traversal_visitor_t
+    {
+        traversal_t::action_t
+        leaf(const dynamic_t&, const traversal_t& traversal) {
+            m_depth = traversal.depth();
+            return traversal_t::proceed;
+        }
+
+        size_t m_depth;
+    } depth;
+
+    assert(traverse(deep, depth));
+    assert(depth.m_depth == 10000);
+}
+
+void
+test_visit() {
+    auto describe = overloaded(
+        [](const dynamic_t::null_t&) { return std::string("null"); },
+        [](dynamic_t::bool_t) { return std::string("bool"); },
+        [](dynamic_t::int_t) { return std::string("int"); },
+        [](dynamic_t::double_t) { return std::string("double"); },
+        [](const dynamic_t::string_t& v) { return v; },
+        [](const dynamic_t::array_t&) { return std::string("array"); },
+        [](const dynamic_t::object_t&) { return std::string("object"); }
+    );
+
+    assert(dynamic_t().visit(describe) == "null");
+    assert(dynamic_t(false).visit(describe) == "bool");
+    assert(dynamic_t(1).visit(describe) == "int");
+    assert(dynamic_t(1.0).visit(describe) == "double");
+    assert(dynamic_t("x").visit(describe) == "x");
+    assert(dynamic_t(dynamic_t::array_t()).visit(describe) == "array");
+    assert(dynamic_t(dynamic_t::object_t()).visit(describe) == "object");
+
+    // The result is the common type of all overloads.
+    const dynamic_t d = 5;
+    auto size = d.visit(overloaded(
+        [](const dynamic_t::null_t&) { return 0; },
+        [](dynamic_t::bool_t) { return 1; },
+        [](dynamic_t::int_t) { return 8l; },
+        [](dynamic_t::double_t) { return 8.0; },
+        [](const dynamic_t::string_t& v) { return v.size(); },
+        [](const dynamic_t::array_t& v) { return v.size(); },
+        [](const dynamic_t::object_t& v) { return v.size(); }
+    ));
+    static_assert(std::is_same<decltype(size), double>::value, "common type of the overloads is expected");
+    assert(size == 8.0);
+
+    // Mutable visits detach shared subtrees.
+    dynamic_t shared = std::vector<int>{1, 2, 3};
+    dynamic_t copies = dynamic_t::array_t{shared, shared};
+    dedup(copies);
+    assert(copies.as_array()[1].is_shared());
+
+    dynamic_t& second = copies.as_array()[1];
+    second.visit(overloaded(
+        [](dynamic_t::array_t& v) { v.push_back(4); },
+        [](dynamic_t::object_t&) { },
+        [](dynamic_t::string_t&) { },
+        [](dynamic_t::double_t&) { },
+        [](dynamic_t::int_t&) { },
+        [](dynamic_t::bool_t&) { },
+        [](dynamic_t::null_t&) { }
+    ));
+    assert(copies.as_array()[0].as_array().size() == 3);
+    assert(copies.as_array()[1].as_array().size() == 4);
+}
+
+dynamic_t
+increment_leaves(const dynamic_t& node) {
+    if (node.is_array()) {
+        dynamic_t::array_t result;
+        for (auto it = node.as_array().begin(); it != node.as_array().end(); ++it) {
+            result.push_back(increment_leaves(*it));
+        }
+        return result;
+    } else if (node.is_object()) {
+        dynamic_t::object_t result;
+        for (auto it = node.as_object().begin(); it != node.as_object().end(); ++it) {
+            result[it->first] = increment_leaves(it->second);
+        }
+        return result;
+    } else {
+        return node.is_int() ? dynamic_t(node.as_int() + 1) : node;
+    }
+}
+
+void
+test_parallel() {
+    dynamic_t d;
+    for (int i = 0; i < 1000; ++i) {
+        dynamic_t record;
+        record.as_object()["id"] = i;
+        record.as_object()["name"] = std::string("record");
+        record.as_object()["values"] = std::vector<int>{i, i + 1, i + 2};
+        d.as_array().push_back(record);
+    }
+
+    thread_pool_t pool(4);
+
+    // Tiny threshold to split as much as possible.
+    std::atomic<size_t> leaves(0);
+    parallel_for_each_leaf(d, [&leaves](const dynamic_t&) { ++leaves; }, pool, 2);
+    assert(leaves == 5000);
+
+    const dynamic_t expected = increment_leaves(d);
+    for (int i = 0; i < 10; ++i) {
+        dynamic_t result = parallel_transform(d, [](const dynamic_t& leaf) {
+            return leaf.is_int() ? dynamic_t(leaf.as_int() + 1) : leaf;
+        }, pool, 2);
+        assert(result == expected);
+    }
+
+    path_t path;
+    for (int i = 0; i < 10; ++i) {
+        assert(parallel_find_if(d, [](const dynamic_t& leaf) {
+            return leaf.is_int() && leaf.as_int() >= 500;
+        }, path, pool, 2));
+        assert(path.to_string() == "/498/values/2");
+    }
+
+    assert(!parallel_find_if(d, [](const dynamic_t& leaf) { return leaf.is_double(); }, path, pool, 2));
+
+    bool failed = false;
+    try {
+        parallel_for_each_leaf(d, [](const dynamic_t& leaf) {
+            if (leaf == 700) {
+                throw std::runtime_error("invalid value");
+            }
+        }, pool, 2);
+    } catch (const std::runtime_error&) {
+        failed = true;
+    }
+    assert(failed);
+}
+
+void
+test_query() {
+    dynamic_t::array_t records;
+    for (int i = 0; i < 10; ++i) {
+        dynamic_t record;
+        record.as_object()["id"] = i;
+        record.as_object()["status"] = std::string(i % 2 ? "active" : "disabled");
+        record.as_object()["weight"] = i * 1.5;
+        record.as_object()["tags"] = std::vector<std::string>{"tag" + std::to_string(i)};
+        if (i == 3) {
+            record.as_object()["limits"].as_object()["memory"] = 1024;
+        }
+        records.push_back(record);
+    }
+
+    predicate_t active("status == \"active\" && weight > 3");
+    assert(filter(records, active) == std::vector<size_t>({3, 5, 7, 9}));
+
+    assert(filter(records, predicate_t("id >= 8 || !(id != 0)")) == std::vector<size_t>({0, 8, 9}));
+    assert(filter(records, predicate_t("weight == 3")) == std::vector<size_t>({2}));
+    assert(filter(records, predicate_t("tags[0] < \"tag2\"")) == std::vector<size_t>({0, 1}));
+    assert(filter(records, predicate_t("limits.memory")) == std::vector<size_t>({3}));
+    assert(filter(records, predicate_t("limits.memory != 1024")).size() == 9);
+    assert(filter(records, predicate_t("status == true")).empty());
+
+    const dynamic_t::array_t projected = select(records, active, projection_t("id, limits.memory, tags[0]"));
+    assert(projected.size() == 4);
+    assert(projected[0].as_object()["id"] == 3);
+    assert(projected[0].as_object()["limits.memory"] == 1024);
+    assert(projected[1].as_object()["limits.memory"].is_null());
+    assert(projected[1].as_object()["tags[0]"] == "tag5");
+
+    const char *malformed[] = { "", "status ==", "(id == 1", "id == 1 &&", "\"a\"", "id == \"a", "tags[x]" };
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); ++i) {
+        bool failed = false;
+        try {
+            predicate_t predicate(malformed[i]);
+        } catch (const query_error&) {
+            failed = true;
+        }
+        assert(failed);
+    }
+}
+
+void
+test_index() {
+    dynamic_t users;
+    for (int i = 0; i < 10; ++i) {
+        dynamic_t user;
+        user.as_object()["id"] = i;
+        user.as_object()["group"] = std::string(i % 3 ? "staff" : "admin");
+        users.as_array().push_back(user);
+    }
+    users.as_array().push_back(dynamic_t::object_t());
+
+    dynamic_t::array_t& array = users.as_array();
+
+    unique_index_t by_id(array, path_t("/id"));
+    assert(by_id.size() == 10);
+    assert(by_id.find(7) == &array[7]);
+    assert(by_id.position(7) == 7);
+    assert(!by_id.find(10));
+    assert(!by_id.find(7.0));
+    assert(by_id.position(10) == unique_index_t::npos);
+
+    multi_index_t by_group(array, path_t("/group"));
+    assert(by_group.size() == 2);
+    assert(by_group.positions("admin") == std::vector<size_t>({0, 3, 6, 9}));
+    assert(by_group.count("nobody") == 0);
+
+    // Appended elements are picked up by update() even if the array reallocates.
+    for (int i = 10; i < 100; ++i) {
+        dynamic_t user;
+        user.as_object()["id"] = i;
+        user.as_object()["group"] = "guest";
+        array.push_back(user);
+    }
+
+    by_id.update();
+    by_group.update();
+    assert(by_id.find(99) == &array.back());
+    assert(by_id.find(7) == &array[7]);
+    assert(by_group.count("guest") == 90);
+
+    std::vector<const dynamic_t*> admins;
+    by_group.find("admin", admins);
+    assert(admins.size() == 4 && admins[1] == &array[3]);
+
+    // Other mutations require rebuild().
+    array.erase(array.begin());
+    by_id.rebuild();
+    assert(by_id.position(1) == 0);
+
+    array.push_back(array[0]);
+    bool failed = false;
+    try {
+        by_id.update();
+    } catch (const index_error&) {
+        failed = true;
+    }
+    assert(failed);
+    assert(by_id.find(99) == &array[99]);
+
+    array.resize(50);
+    by_id.update();
+    assert(by_id.size() == 49);
+    assert(!by_id.contains(99));
+}
+
+struct celsius_t {
+    double degrees;
+};
+
+namespace cocaine {
+
+// A converter without try_convert().
+template<>
+struct dynamic_converter<celsius_t, void> {
+    typedef celsius_t result_type;
+
+    static
+    result_type
+    convert(const dynamic_t& from) {
+        return celsius_t { from.to<double>() };
+    }
+
+    static
+    bool
+    convertible(const dynamic_t& from) {
+        return from.convertible_to<double>();
+    }
+};
+
+} // namespace cocaine
+
+void
+test_try_to() {
+    dynamic_t d = std::vector<dynamic_t>({1, 2.5, 3});
+
+    assert(!d.try_to<bool>());
+    assert(!d.try_to<std::string>());
+    assert(!d.try_to<std::vector<std::string>>());
+    assert((!d.try_to<std::map<std::string, int>>()));
+    assert(d.try_to<const dynamic_t&>().get_ptr() == &d);
+    assert(&*d.try_to<dynamic_t::array_t>() == &d.as_array());
+    assert(*d.try_to<std::vector<int>>() == std::vector<int>({1, 2, 3}));
+    assert(*d.try_to<std::vector<double>>() == std::vector<double>({1, 2.5, 3}));
+    assert((std::get<1>(*d.try_to<std::tuple<int, double, int>>()) == 2.5));
+    assert((!d.try_to<std::tuple<int, std::string, int>>()));
+    assert((!d.try_to<std::tuple<int, double>>()));
+    assert(d.as_array()[1].try_to<celsius_t>()->degrees == 2.5);
+
+    d.as_array().push_back("four");
+    assert(!d.try_to<std::vector<int>>());
+    assert(*d.as_array()[3].try_to<const char*>() == std::string("four"));
+    assert(!d.as_array()[3].try_to<celsius_t>());
+
+    dynamic_t o = dynamic_t::object_t();
+    assert((o.try_to<std::map<std::string, int>>()->empty()));
+    assert((o.convertible_to<std::map<std::string, int>>()));
+
+    o.as_object()["a"] = 1;
+    o.as_object()["b"] = "two";
+    assert((!o.try_to<std::map<std::string, int>>()));
+    assert((!o.try_to<std::unordered_map<std::string, int>>()));
+    // All the members are checked, not only the first one.
+    assert((!o.convertible_to<std::map<std::string, int>>()));
+    assert((!o.convertible_to<std::unordered_map<std::string, int>>()));
+
+    o.as_object()["b"] = 2;
+    assert((o.try_to<std::unordered_map<std::string, int>>()->at("b") == 2));
+    assert(o.try_to<const dynamic_t::object_t&>()->size() == 2);
+}
+
+void
+test_view() {
+    dynamic_t d = std::vector<int>({1, 2, 3, 4, 5});
+
+    auto view = d.as_view<std::vector<int>>();
+    assert(view.size() == 5);
+    assert(view[2] == 3 && view.front() == 1 && view.back() == 5);
+    assert(std::accumulate(view.begin(), view.end(), 0) == 15);
+    assert(view.end() - view.begin() == 5);
+    assert(view.convertible());
+
+    auto middle = view.slice(1, 3);
+    assert(middle.size() == 3 && middle.front() == 2 && middle.back() == 4);
+    assert(middle.slice(1).size() == 2 && middle.slice(1)[1] == 4);
+    assert(view.slice(5).empty());
+    assert(view.slice(3, 100).size() == 2);
+
+    bool failed = false;
+    try {
+        view.slice(6);
+    } catch (const std::out_of_range&) {
+        failed = true;
+    }
+    assert(failed);
+
+    // The view doesn't copy, so it sees the changes and converts on dereference.
+    d.as_array()[0] = 10.5;
+    assert(d.as_view<std::vector<double>>()[0] == 10.5);
+    assert(&*d.as_view<std::vector<dynamic_t>>().begin() == &d.as_array()[0]);
+
+    d.as_array()[1] = "two";
+    assert(!view.convertible());
+    assert(view.slice(2).convertible());
+
+    dynamic_t o = dynamic_t::object_t();
+    o.as_object()["a"] = "x";
+    o.as_object()["b"] = "y";
+
+    auto members = o.as_view<std::map<std::string, std::string>>();
+    assert(members.size() == 2);
+    assert(&members.at("a") == &o.as_object()["a"].as_string());
+    assert((*members.find("b")).second == "y");
+    assert(members.find("c") == members.end());
+
+    std::string joined;
+    for (auto it = members.begin(); it != members.end(); ++it) {
+        joined += (*it).first + "=" + (*it).second;
+    }
+    assert(joined == "a=xb=y");
+
+    failed = false;
+    try {
+        o.as_view<std::vector<int>>();
+    } catch (const boost::bad_get&) {
+        failed = true;
+    }
+    assert(failed);
+}
+
+struct endpoint_t {
+    std::string host;
+    int port;
+};
+
+COCAINE_DYNAMIC_REFLECT(endpoint_t, (host)(port))
+
+struct service_t {
+    std::string name;
+    std::vector<endpoint_t> endpoints;
+    double weight;
+    bool enabled;
+
+    service_t() :
+        weight(1),
+        enabled(true)
+    {
+        // pass
+    }
+};
+
+COCAINE_DYNAMIC_REFLECT(service_t, (name)(endpoints)(weight)(enabled))
+
+void
+test_reflect() {
+    service_t service;
+    service.name = "storage";
+    service.endpoints.push_back(endpoint_t { "localhost", 10053 });
+    service.endpoints.push_back(endpoint_t { "::1", 10054 });
+    service.enabled = false;
+
+    const dynamic_t d = service;
+    assert(d.as_object().size() == 4);
+    assert(d.as_object()["name"] == "storage");
+    assert(d.as_object()["endpoints"].as_array()[1].as_object()["port"] == 10054);
+    assert(d.as_object()["weight"] == 1.0);
+    assert(d.as_object()["enabled"] == false);
+
+    assert(d.convertible_to<service_t>());
+    const service_t converted = d.to<service_t>();
+    assert(converted.name == "storage");
+    assert(converted.endpoints.size() == 2 && converted.endpoints[1].host == "::1");
+    assert(!converted.enabled);
+
+    // Missing members keep their defaults, unknown keys are ignored.
+    dynamic_t partial = dynamic_t::object_t();
+    partial.as_object()["aaa"] = 1;
+    partial.as_object()["name"] = "cache";
+    partial.as_object()["zzz"] = 2;
+    const service_t defaults = *partial.try_to<service_t>();
+    assert(defaults.name == "cache" && defaults.weight == 1 && defaults.enabled && defaults.endpoints.empty());
+
+    partial.as_object()["weight"] = "heavy";
+    assert(!partial.convertible_to<service_t>());
+    assert(!partial.try_to<service_t>());
+    assert(!dynamic_t("storage").try_to<service_t>());
+}
+
+void
+test_numeric() {
+    std::vector<dynamic_t> mixed;
+    for (int i = 0; i < 1000; ++i) {
+        // Long runs of ints and doubles with single elements of the other type in between.
+        if (i % 300 == 7) {
+            mixed.push_back(i + 0.5);
+        } else if (i < 500) {
+            mixed.push_back(i);
+        } else {
+            mixed.push_back(i * 0.25);
+        }
+    }
+    const dynamic_t d = mixed;
+
+    const std::vector<double> doubles = to_numbers<double>(d);
+    const std::vector<float> floats = to_numbers<float>(d);
+    const std::vector<int32_t> ints = to_numbers<int32_t>(d);
+    assert(doubles.size() == 1000 && floats.size() == 1000 && ints.size() == 1000);
+
+    for (size_t i = 0; i < mixed.size(); ++i) {
+        assert(doubles[i] == mixed[i].to<double>());
+        assert(floats[i] == mixed[i].to<float>());
+        assert(ints[i] == mixed[i].to<int32_t>());
+    }
+
+    assert(to_numbers<uint8_t>(dynamic_t(std::vector<int>({0, 255}))) == std::vector<uint8_t>({0, 255}));
+    assert(to_numbers<int64_t>(dynamic_t(std::vector<double>({-1.5, 1e18}))) == std::vector<int64_t>({-1, 1000000000000000000}));
+    assert(std::isinf(to_numbers<float>(dynamic_t(std::vector<double>({std::numeric_limits<double>::infinity()})))[0]));
+
+    std::vector<uint8_t> bytes;
+    assert(!try_to_numbers(dynamic_t(std::vector<int>({0, 256})), bytes));
+    assert(!try_to_numbers(dynamic_t(std::vector<int>({-1})), bytes));
+    assert(!try_to_numbers(dynamic_t(std::vector<double>({-1.0})), bytes));
+    assert(try_to_numbers(dynamic_t(std::vector<double>({-0.5})), bytes) && bytes[0] == 0);
+    assert(!try_to_numbers(dynamic_t("numbers"), bytes));
+
+    std::vector<float> single;
+    assert(!try_to_numbers(dynamic_t(std::vector<double>({1.0, 1e39})), single));
+
+    std::vector<int32_t> wide;
+    assert(!try_to_numbers(dynamic_t(std::vector<double>({2147483648.0})), wide));
+    assert(try_to_numbers(dynamic_t(std::vector<double>({-2147483648.0})), wide));
+
+    mixed[600] = "six hundred";
+    mixed[900] = 1e10;
+
+    size_t index = 0;
+    try {
+        to_numbers<double>(mixed);
+    } catch (const numeric_error& e) {
+        index = e.index();
+    }
+    assert(index == 600);
+
+    mixed[600] = 600;
+    try {
+        to_numbers<int32_t>(mixed);
+    } catch (const numeric_error& e) {
+        index = e.index();
+    }
+    assert(index == 900);
+}
+
+void
+test_string_view() {
+    const char buffer[] = "{\"identifier\": 1}";
+    const dynamic_t::string_view_t key(buffer + 2, 10);
+
+    dynamic_t d = dynamic_t::object_t();
+    dynamic_t::object_t& object = d.as_object();
+
+    object[key] = 1;
+    object["name"] = "storage";
+    assert(object.size() == 2);
+    assert(object.at(std::string("identifier")) == 1);
+
+    assert(object.find(key) == object.find(std::string("identifier")));
+    assert(object.find("name")->second == "storage");
+    assert(object.find(dynamic_t::string_view_t("nam")) == object.end());
+    assert(object.count(key) == 1 && object.count("missing") == 0);
+    assert(object.at(key) == 1);
+
+    const dynamic_t::object_t& constant = object;
+    const dynamic_t def = "default";
+    assert(constant.at("missing", def) == "default");
+    assert(constant["name"] == "storage");
+    assert(constant.find("name") == std::next(constant.begin()));
+
+    // Existing members aren't replaced.
+    object[key] = 2;
+    assert(object.size() == 2 && object["identifier"] == 2);
+
+    bool failed = false;
+    try {
+        constant.at("missing");
+    } catch (const std::out_of_range&) {
+        failed = true;
+    }
+    assert(failed);
+
+    const dynamic_t::string_view_t name = object["name"].as_string_view();
+    assert(name == "storage" && name.data() == object["name"].as_string().data());
+    assert(object["name"].to<dynamic_t::string_view_t>() == "storage");
+    assert(!object["identifier"].try_to<dynamic_t::string_view_t>());
+
+    const dynamic_t copy = key;
+    assert(copy.is_string() && copy == "identifier");
+}
+
+void
+test_emplace() {
+    dynamic_t d;
+    d.reserve(4);
+    assert(d.is_array() && d.as_array().capacity() >= 4);
+
+    d.emplace_back(1);
+    d.emplace_back("two");
+    d.emplace_back(std::vector<int>({3}));
+    assert(d.emplace_back().is_null());
+    assert(d == dynamic_t(std::vector<dynamic_t>({1, "two", std::vector<int>({3}), dynamic_t()})));
+
+    dynamic_t o;
+    assert(o.try_emplace("a", 1).second);
+    assert(o.is_object());
+
+    std::string key = "b";
+    assert(o.try_emplace(key, "bee").second);
+
+    std::string moved = "c";
+    auto inserted = o.as_object().try_emplace(std::move(moved), std::vector<int>({1, 2}));
+    assert(inserted.second && inserted.first->first == "c" && inserted.first->second.as_array().size() == 2);
+
+    // Existing members are kept, and the arguments are left intact.
+    dynamic_t value = "replacement";
+    std::string existing = "a";
+    inserted = o.as_object().try_emplace(std::move(existing), std::move(value));
+    assert(!inserted.second && inserted.first->second == 1);
+    assert(existing == "a" && value == "replacement");
+
+    assert(!o.try_emplace(dynamic_t::string_view_t("b"), 2).second);
+    assert(o.as_object().size() == 3 && o.as_object()["b"] == "bee");
+
+    // Moving a node out of its own subtree.
+    dynamic_t tree = std::vector<dynamic_t>({std::vector<dynamic_t>({1, 2}), 3});
+    tree = std::move(tree.as_array()[0]);
+    assert(tree == dynamic_t(std::vector<int>({1, 2})));
+    tree = std::move(tree.as_array()[1]);
+    assert(tree == 2);
+
+    dynamic_t source = std::string("a string long enough to be allocated on the heap");
+    const char *data = source.as_string().data();
+    dynamic_t target(std::move(source));
+    assert(target.as_string().data() == data);
+}
+
+void
+test_builder() {
+    dynamic_t source = dynamic_t::object_t();
+    source.as_object()["array"] = std::vector<dynamic_t>({1, 2.5, "three", dynamic_t(), true});
+    source.as_object()["empty"] = dynamic_t::object_t();
+    source.as_object()["nested"].as_object()["key"] = std::vector<dynamic_t>({dynamic_t::array_t()});
+
+    dynamic_t built;
+    dynamic_builder_t builder(built);
+    assert(!builder.done());
+    emit(source, builder);
+    assert(builder.done());
+    assert(built == source);
+
+    // Arrays are reserved from the size hints.
+    assert(built.as_object()["array"].as_array().capacity() == 5);
+
+    // Keys out of order and duplicate keys, the last value wins.
+    dynamic_t object;
+    dynamic_builder_t unordered(object);
+    unordered.begin_object(events::unknown_size);
+    unordered.key("b", 1);
+    unordered.int_value(1);
+    unordered.key("a", 1);
+    unordered.string_value(std::string("first"));
+    unordered.key("a", 1);
+    unordered.begin_array(events::unknown_size);
+    unordered.null_value();
+    unordered.end_array();
+    unordered.key("c", 1);
+    unordered.double_value(0.5);
+    unordered.key("c", 1);
+    unordered.bool_value(false);
+    unordered.end_object();
+    assert(unordered.done());
+    assert(object.as_object().size() == 3);
+    assert(object.as_object()["a"] == dynamic_t(std::vector<dynamic_t>({dynamic_t()})));
+    assert(object.as_object()["b"] == 1);
+    assert(object.as_object()["c"] == false);
+
+    dynamic_t scalar = "overwritten";
+    dynamic_builder_t single(scalar);
+    single.string_value("abc", 3);
+    assert(single.done() && scalar == "abc");
+}
+
+void
+test_snapshot() {
+    dynamic_snapshot_t snapshot((dynamic_t::object_t()));
+
+    {
+        dynamic_snapshot_t::reader_t reader(snapshot);
+
+        {
+            dynamic_snapshot_t::guard_t guard(reader);
+            assert(guard->is_object() && guard->as_object().empty());
+
+            // The guard keeps the version it has taken, nested guards share it.
+            snapshot.publish(std::vector<int>({1, 2, 3}));
+            assert(guard->is_object());
+            assert(snapshot.retired() == 1);
+
+            dynamic_snapshot_t::guard_t nested(reader);
+            assert(&*nested == &*guard);
+        }
+
+        assert(snapshot.reclaim() == 1);
+        assert(snapshot.retired() == 0);
+
+        dynamic_snapshot_t::guard_t guard(reader);
+        assert((*guard == std::vector<int>({1, 2, 3})));
+
+        // Versions retired after the guard was taken are still pinned by it, the older ones are not.
+        snapshot.publish(1);
+        snapshot.publish(2);
+        assert(snapshot.retired() == 2);
+    }
+
+    // Publishing reclaims the versions nobody reads.
+    snapshot.publish(3);
+    assert(snapshot.retired() == 0);
+
+    // Readers never see a half-published document and versions don't go back.
+    std::atomic<bool> stopped(false);
+    std::atomic<size_t> errors(0);
+    std::vector<std::thread> readers;
+
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&snapshot, &stopped, &errors] {
+            dynamic_snapshot_t::reader_t reader(snapshot);
+            int last = 0;
+
+            while (!stopped) {
+                dynamic_snapshot_t::guard_t guard(reader);
+
+                if (!guard->is_object()) {
+                    continue;
+                }
+
+                const int version = guard->as_object().at("version").to<int>();
+
+                if (version < last || guard->as_object().at("copy").as_array().size() != static_cast<size_t>(version)) {
+                    ++errors;
+                }
+
+                last = version;
+            }
+        });
+    }
+
+    for (int version = 1; version <= 1000; ++version) {
+        dynamic_t value = dynamic_t::object_t();
+        value.as_object()["version"] = version;
+        value.as_object()["copy"] = std::vector<int>(version, version);
+        snapshot.publish(std::move(value));
+    }
+
+    stopped = true;
+
+    for (auto it = readers.begin(); it != readers.end(); ++it) {
+        it->join();
+    }
+
+    assert(errors == 0);
+
+    snapshot.reclaim();
+    assert(snapshot.retired() == 0);
+}
+
+void
+test_concurrent() {
+    thread_pool_t pool(4);
+
+    // Every producer inserts its own keys and a shared one.
+    concurrent_builder_t objects;
+    std::vector<std::thread> producers;
+
+    for (int i = 0; i < 5; ++i) {
+        concurrent_builder_t::shard_t& shard = objects.acquire();
+
+        producers.emplace_back([&shard, i] {
+            for (int j = 999; j >= 0; --j) {
+                shard.insert("key" + std::to_string(i * 1000 + j), i * 1000 + j);
+            }
+
+            shard.insert("shared", i);
+            shard.insert("shared", i * 10);
+        });
+    }
+
+    for (auto it = producers.begin(); it != producers.end(); ++it) {
+        it->join();
+    }
+
+    dynamic_t object = objects.build(pool);
+    assert(object.as_object().size() == 5001);
+    assert(object.as_object()["key1234"] == 1234);
+    assert(object.as_object()["key4999"] == 4999);
+
+    // The last value of the shard acquired last.
+    assert(object.as_object()["shared"] == 40);
+
+    // Shards are emptied by the build.
+    assert(objects.build(pool) == dynamic_t::array_t());
+
+    // Elements in the order of the shards.
+    concurrent_builder_t arrays;
+    concurrent_builder_t::shard_t& first = arrays.acquire();
+    concurrent_builder_t::shard_t& second = arrays.acquire();
+    concurrent_builder_t::shard_t& third = arrays.acquire();
+
+    second.push_back(3);
+    first.push_back(1);
+    second.push_back(4);
+    first.push_back(2);
+    third.push_back(dynamic_t::object_t());
+
+    assert((arrays.build(pool) == std::vector<dynamic_t>({1, 2, 3, 4, dynamic_t::object_t()})));
+
+    first.push_back(1);
+    second.insert("key", 1);
+
+    bool thrown = false;
+    try {
+        arrays.build(pool);
+    } catch (const std::logic_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void
+test_reclaim() {
+    reclaimer_t reclaimer(100, 4);
+
+    // Small trees are destroyed right away.
+    dynamic_t small = std::vector<int>(98);
+    assert(!reclaimer.retire(small));
+    assert(small.is_null());
+
+    dynamic_t nested = dynamic_t::object_t();
+    for (int i = 0; i < 10; ++i) {
+        nested.as_object()["key" + std::to_string(i)] = std::vector<int>(10, i);
+    }
+
+    assert(reclaimer.retire(std::move(nested)));
+    assert(nested.is_null());
+
+    reclaimer.drain();
+
+    reclaimer_t::stats_t stats = reclaimer.stats();
+    assert(stats.queued == 0 && stats.peak == 1);
+    assert(stats.deferred == 1 && stats.small == 1 && stats.overflowed == 0);
+
+    // The queue is bounded, the rest is destroyed by the calling thread.
+    size_t deferred = 0;
+    for (int i = 0; i < 100; ++i) {
+        deferred += reclaimer.retire(dynamic_t(std::vector<int>(1000, i)));
+    }
+
+    reclaimer.drain();
+
+    stats = reclaimer.stats();
+    assert(stats.queued == 0 && stats.peak <= 4);
+    assert(stats.deferred == deferred + 1 && stats.overflowed == 100 - deferred);
+}
+
 const unsigned int MAX_DEPTH = 26;
 const size_t BASE_SIZE = 120;
 
 void
-fill_dynamic(dynamic_t& dest, unsigned int depth) {
-    int r = 0;
+fill_events(dynamic_builder_t& builder, unsigned int depth) {
+    int r = 0;
+
+    if (depth < MAX_DEPTH / 5) {
+        r = 4 + rand() % 2;
+    } else if (depth > MAX_DEPTH) {
+        r = rand() % 4;
+    } else {
+        r = rand() % 6;
+    }
+
+    if (r == 0) {
+        builder.bool_value(true);
+    } else if (r == 1) {
+        builder.int_value(1337);
+    } else if (r == 2) {
+        builder.double_value(64813.101);
+    } else if (r == 3) {
+        std::string s;
+        size_t size = rand() % (10 * BASE_SIZE);
+        s.reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            s.push_back(char(30 + rand() % 30));
+        }
+        builder.string_value(std::move(s));
+    } else if (r == 4) {
+        size_t size = rand() % (BASE_SIZE / 10);
+        builder.begin_array(size);
+        for (size_t i = 0; i < size; ++i) {
+            fill_events(builder, depth + 1);
+        }
+        builder.end_array();
+    } else if (r == 5) {
+        builder.begin_object(events::unknown_size);
+
+        for (size_t i = 0; i < size_t(rand() % (BASE_SIZE / 10)); ++i) {
+            std::string key;
+            size_t size = rand() % BASE_SIZE;
+            key.reserve(size);
+            for (size_t i = 0; i < size; ++i) {
+                key.push_back(char(30 + rand() % 30));
+            }
+
+            builder.key(key.data(), key.size());
+            fill_events(builder, depth + 1);
+        }
+
+        builder.end_object();
+    }
+}
+
+void
+fill_dynamic(dynamic_t& dest, unsigned int depth) {
+    dynamic_builder_t builder(dest);
+    fill_events(builder, depth);
+}
+
+struct dynamic_walker :
+    public boost::static_visitor<>
+{
+    dynamic_walker() :
+        m_nulls(0),
+        m_bools(0),
+        m_ints(0),
+        m_doubles(0),
+        m_strings(0),
+        m_arrays(0),
+        m_objects(0)
+    {
+        // pass
+    }
+
+    void
+    operator()(const dynamic_t::null_t&) {
+        ++m_nulls;
+    }
+
+    void
+    operator()(const dynamic_t::bool_t&) {
+        ++m_bools;
+    }
+
+    void
+    operator()(const dynamic_t::int_t&) {
+        ++m_ints;
+    }
+
+    void
+    operator()(const dynamic_t::double_t&) {
+        ++m_doubles;
+    }
+
+    void
+    operator()(const dynamic_t::string_t&) {
+        ++m_strings;
+    }
+
+    void
+    operator()(const dynamic_t::array_t& v) {
+        ++m_arrays;
+
+        for (auto it = v.begin(); it != v.end(); ++it) {
+            it->apply(*this);
+        }
+    }
+
+    void
+    operator()(const dynamic_t::object_t& v) {
+        ++m_objects;
+
+        for (auto it = v.begin(); it != v.end(); ++it) {
+            it->second.apply(*this);
+        }
+    }
+
+public:
+    size_t m_nulls;
+    size_t m_bools;
+    size_t m_ints;
+    size_t m_doubles;
+    size_t m_strings;
+    size_t m_arrays;
+    size_t m_objects;
+};
+
+void
+test_dynamic_performance() {
+    srand(1337);
+
+    dynamic_t d;
+
+    std::cout << "Start dynamic perfomance test" << std::endl;
+
+    fill_dynamic(d, 0);
+
+    std::cout << "dynamic object has been filled" << std::endl;
+
+    time_t now = time(0);
+
+    for (int i = 0; i < 10; ++i) {
+        dynamic_walker w;
+        d.apply(w);
+    }
+
+    std::cout << "Walk time: " << (time(0) - now) << std::endl;
+
+    dynamic_walker w;
+
+    d.apply(w);
+
+    std::cout << "STAT: "
+              << w.m_nulls << ", "
+              << w.m_bools << ", "
+              << w.m_ints << ", "
+              << w.m_doubles << ", "
+              << w.m_strings << ", "
+              << w.m_arrays << ", "
+              << w.m_objects << std::endl;
+}
+
+struct traversal_walker :
+    public traversal_visitor_t
+{
+    traversal_walker() :
+        m_scalars(0),
+        m_strings(0),
+        m_containers(0)
+    {
+        // pass
+    }
+
+    traversal_t::action_t
+    enter(const dynamic_t&, const traversal_t&) {
+        ++m_containers;
+        return traversal_t::proceed;
+    }
+
+    traversal_t::action_t
+    leaf(const dynamic_t& node, const traversal_t&) {
+        if (node.is_string()) {
+            ++m_strings;
+        } else {
+            ++m_scalars;
+        }
+
+        return traversal_t::proceed;
+    }
+
+public:
+    size_t m_scalars;
+    size_t m_strings;
+    size_t m_containers;
+};
+
+void
+test_traverse_performance() {
+    srand(1337);
+
+    dynamic_t d;
+
+    std::cout << "Start traversal perfomance test" << std::endl;
+
+    fill_dynamic(d, 0);
+
+    clock_t start = clock();
+
+    for (int i = 0; i < 10; ++i) {
+        dynamic_walker w;
+        d.apply(w);
+    }
+
+    std::cout << "recursive walk time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
+
+    traversal_t traversal;
+    for (int i = 0; i < 10; ++i) {
+        traversal_walker w;
+        traversal.run(d, w);
+    }
+
+    std::cout << "iterative walk time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+
+    dynamic_walker w1;
+    d.apply(w1);
+    traversal_walker w2;
+    traverse(d, w2);
+    assert(w1.m_arrays + w1.m_objects == w2.m_containers);
+    assert(w1.m_strings == w2.m_strings);
+}
+
+struct type_counter :
+    public boost::static_visitor<size_t>
+{
+    size_t
+    operator()(const dynamic_t::null_t&) const {
+        return 0;
+    }
+
+    size_t
+    operator()(const dynamic_t::bool_t&) const {
+        return 1;
+    }
+
+    size_t
+    operator()(const dynamic_t::int_t&) const {
+        return 2;
+    }
+
+    size_t
+    operator()(const dynamic_t::double_t&) const {
+        return 3;
+    }
+
+    size_t
+    operator()(const dynamic_t::string_t&) const {
+        return 4;
+    }
+
+    size_t
+    operator()(const dynamic_t::array_t&) const {
+        return 5;
+    }
+
+    size_t
+    operator()(const dynamic_t::object_t&) const {
+        return 6;
+    }
+};
+
+void
+test_visit_performance() {
+    srand(1337);
+
+    std::cout << "Start visit perfomance test" << std::endl;
+
+    dynamic_t::array_t values;
+    values.reserve(1000000);
+    for (int i = 0; i < 1000000; ++i) {
+        switch (rand() % 5) {
+        case 0: values.emplace_back(); break;
+        case 1: values.emplace_back(true); break;
+        case 2: values.emplace_back(i); break;
+        case 3: values.emplace_back(i * 0.5); break;
+        default: values.emplace_back(std::string("value")); break;
+        }
+    }
+
+    clock_t start = clock();
+
+    size_t applied = 0;
+    for (int i = 0; i < 20; ++i) {
+        for (auto it = values.begin(); it != values.end(); ++it) {
+            applied += it->apply(type_counter());
+        }
+    }
+
+    std::cout << "apply time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
+
+    auto counter = overloaded(
+        [](const dynamic_t::null_t&) -> size_t { return 0; },
+        [](const dynamic_t::bool_t&) -> size_t { return 1; },
+        [](const dynamic_t::int_t&) -> size_t { return 2; },
+        [](const dynamic_t::double_t&) -> size_t { return 3; },
+        [](const dynamic_t::string_t&) -> size_t { return 4; },
+        [](const dynamic_t::array_t&) -> size_t { return 5; },
+        [](const dynamic_t::object_t&) -> size_t { return 6; }
+    );
+
+    const dynamic_t::array_t& constant = values;
+    size_t visited = 0;
+    for (int i = 0; i < 20; ++i) {
+        for (auto it = constant.begin(); it != constant.end(); ++it) {
+            visited += it->visit(counter);
+        }
+    }
+
+    std::cout << "visit time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+
+    assert(applied == visited);
+}
+
+void
+test_parallel_performance() {
+    std::cout << "Start parallel perfomance test" << std::endl;
+
+    // About a million nodes.
+    dynamic_t d;
+    for (int i = 0; i < 100000; ++i) {
+        dynamic_t record;
+        record.as_object()["identifier"] = i;
+        record.as_object()["status"] = std::string(i % 3 ? "active" : "disabled");
+        record.as_object()["weight"] = i * 0.5;
+        record.as_object()["tags"] = std::vector<std::string>{"first", "second", "third"};
+        record.as_object()["limits"] = std::vector<int>{i, 2 * i};
+        d.as_array().push_back(record);
+    }
+
+    // clock() counts the time of all threads, so the wall time is measured instead.
+    typedef std::chrono::steady_clock clock_type;
+
+    auto start = clock_type::now();
+
+    dynamic_t expected;
+    for (int i = 0; i < 10; ++i) {
+        expected = increment_leaves(d);
+    }
+
+    std::cout << "sequential transform time: " << std::chrono::duration<double>(clock_type::now() - start).count() << std::endl;
+
+    for (size_t threads = 1; threads <= std::max(4u, std::thread::hardware_concurrency()); threads *= 2) {
+        thread_pool_t pool(threads);
+
+        start = clock_type::now();
+
+        std::atomic<size_t> invalid(0);
+        for (int i = 0; i < 10; ++i) {
+            parallel_for_each_leaf(d, [&invalid](const dynamic_t& leaf) {
+                if (leaf.is_string() && leaf.as_string().empty()) {
+                    ++invalid;
+                }
+            }, pool);
+        }
+
+        const double validate = std::chrono::duration<double>(clock_type::now() - start).count();
+        start = clock_type::now();
+
+        dynamic_t result;
+        for (int i = 0; i < 10; ++i) {
+            result = parallel_transform(d, [](const dynamic_t& leaf) {
+                return leaf.is_int() ? dynamic_t(leaf.as_int() + 1) : leaf;
+            }, pool);
+        }
+
+        const double transform = std::chrono::duration<double>(clock_type::now() - start).count();
+        assert(result == expected);
+
+        std::cout << threads << " threads: validate time " << validate << ", transform time " << transform << std::endl;
+    }
+}
+
+void
+test_query_performance() {
+    std::cout << "Start query perfomance test" << std::endl;
+
+    dynamic_t::array_t records;
+    records.reserve(1000000);
+    for (int i = 0; i < 1000000; ++i) {
+        dynamic_t record;
+        record.as_object()["identifier"] = i;
+        record.as_object()["status"] = std::string(i % 3 ? "active" : "disabled");
+        record.as_object()["weight"] = (i % 10) * 0.5;
+        record.as_object()["created_timestamp"] = 1400000000 + i;
+        records.push_back(record);
+    }
+
+    clock_t start = clock();
+
+    std::vector<size_t> handwritten;
+    for (int i = 0; i < 10; ++i) {
+        handwritten.clear();
+
+        for (size_t j = 0; j < records.size(); ++j) {
+            const dynamic_t::object_t& record = records[j].as_object();
+
+            auto status = record.find("status");
+            if (status == record.end() || !status->second.is_string() || status->second.as_string() != "active") {
+                continue;
+            }
+
+            auto weight = record.find("weight");
+            if (weight != record.end() && weight->second.convertible_to<double>() && weight->second.to<double>() > 3) {
+                handwritten.push_back(j);
+            }
+        }
+    }
+
+    std::cout << "hand-written loop time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
+
+    const predicate_t predicate("status == \"active\" && weight > 3");
+
+    std::vector<size_t> compiled;
+    for (int i = 0; i < 10; ++i) {
+        compiled.clear();
+        filter(records, predicate, compiled);
+    }
+
+    std::cout << "compiled query time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+
+    assert(compiled == handwritten);
+}
+
+void
+test_index_performance() {
+    std::cout << "Start index perfomance test" << std::endl;
+
+    dynamic_t::array_t users;
+    for (int i = 0; i < 10000; ++i) {
+        dynamic_t user;
+        user.as_object()["id"] = i;
+        user.as_object()["name"] = "user" + std::to_string(i);
+        users.push_back(user);
+    }
+
+    std::vector<dynamic_t> keys;
+    for (int i = 0; i < 10000; ++i) {
+        keys.push_back(dynamic_t((i * 7919) % 10000));
+    }
+
+    clock_t start = clock();
+
+    size_t scanned = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        for (size_t j = 0; j < users.size(); ++j) {
+            if (users[j].as_object()["id"] == keys[i]) {
+                ++scanned;
+                break;
+            }
+        }
+    }
+
+    std::cout << "linear scan time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
+
+    const unique_index_t index(users, path_t("/id"));
+
+    size_t indexed = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (index.find(keys[i])) {
+            ++indexed;
+        }
+    }
+
+    std::cout << "index build and lookup time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+
+    assert(scanned == indexed);
+}
+
+void
+test_try_to_performance() {
+    std::cout << "Start try_to perfomance test" << std::endl;
+
+    // Every other request carries a string among the numbers.
+    std::vector<dynamic_t> requests;
+    for (int i = 0; i < 1000; ++i) {
+        dynamic_t request = std::vector<int>(100, i);
+        if (i % 2) {
+            request.as_array()[50] = "bad";
+        }
+        requests.push_back(request);
+    }
+
+    clock_t start = clock();
+
+    size_t accepted = 0;
+    for (int i = 0; i < 100; ++i) {
+        for (size_t j = 0; j < requests.size(); ++j) {
+            if (requests[j].convertible_to<std::vector<int>>()) {
+                accepted += requests[j].to<std::vector<int>>().size();
+            }
+        }
+    }
+
+    std::cout << "convertible_to and to time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
+
+    size_t caught = 0;
+    for (int i = 0; i < 100; ++i) {
+        for (size_t j = 0; j < requests.size(); ++j) {
+            try {
+                caught += requests[j].to<std::vector<int>>().size();
+            } catch (const boost::bad_get&) {
+                // pass
+            }
+        }
+    }
+
+    std::cout << "to with exceptions time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
+
+    size_t tried = 0;
+    for (int i = 0; i < 100; ++i) {
+        for (size_t j = 0; j < requests.size(); ++j) {
+            if (auto result = requests[j].try_to<std::vector<int>>()) {
+                tried += result->size();
+            }
+        }
+    }
+
+    std::cout << "try_to time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+
+    assert(accepted == caught && accepted == tried);
+}
+
+void
+test_view_performance() {
+    std::cout << "Start view perfomance test" << std::endl;
+
+    const dynamic_t d = std::vector<int>(1000000, 7);
+
+    clock_t start = clock();
+
+    int64_t copied = 0;
+    for (int i = 0; i < 10; ++i) {
+        const std::vector<int> values = d.to<std::vector<int>>();
+        copied += std::accumulate(values.begin(), values.end(), int64_t(0));
+    }
+
+    std::cout << "to<std::vector<int>> time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
+
+    int64_t viewed = 0;
+    for (int i = 0; i < 10; ++i) {
+        const auto values = d.as_view<std::vector<int>>();
+        viewed += std::accumulate(values.begin(), values.end(), int64_t(0));
+    }
+
+    std::cout << "as_view<std::vector<int>> time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+
+    assert(copied == viewed);
+}
+
+void
+test_reflect_performance() {
+    std::cout << "Start reflection perfomance test" << std::endl;
+
+    endpoint_t endpoint = { "localhost", 10053 };
+    dynamic_t d = endpoint;
+    for (int i = 0; i < 8; ++i) {
+        d.as_object()["unused" + std::to_string(i)] = i;
+    }
+
+    clock_t start = clock();
+
+    size_t handwritten = 0;
+    for (int i = 0; i < 1000000; ++i) {
+        const dynamic_t::object_t& object = d.as_object();
+
+        endpoint_t result;
+        auto host = object.find("host");
+        if (host != object.end()) {
+            result.host = host->second.to<std::string>();
+        }
+        auto port = object.find("port");
+        if (port != object.end()) {
+            result.port = port->second.to<int>();
+        }
+
+        handwritten += result.port;
+    }
+
+    std::cout << "hand-written lookups time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
+
+    size_t reflected = 0;
+    for (int i = 0; i < 1000000; ++i) {
+        reflected += d.to<endpoint_t>().port;
+    }
+
+    std::cout << "reflected merge time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+
+    assert(handwritten == reflected);
+}
+
+void
+test_numeric_performance() {
+    std::cout << "Start numeric perfomance test" << std::endl;
+
+    std::vector<dynamic_t> values;
+    for (int i = 0; i < 1000000; ++i) {
+        values.push_back(i % 1000 < 500 ? dynamic_t(i) : dynamic_t(i * 0.5));
+    }
+    const dynamic_t d = values;
+
+    clock_t start = clock();
+
+    double converted = 0;
+    for (int i = 0; i < 10; ++i) {
+        converted += d.to<std::vector<float>>().back();
+    }
+
+    std::cout << "to<std::vector<float>> time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
+
+    double bulk = 0;
+    for (int i = 0; i < 10; ++i) {
+        bulk += to_numbers<float>(d).back();
+    }
+
+    std::cout << "to_numbers<float> time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+
+    assert(converted == bulk);
+}
+
+void
+test_string_view_performance() {
+    std::cout << "Start string view lookup perfomance test" << std::endl;
+
+    dynamic_t d = dynamic_t::object_t();
+    std::vector<std::string> keys;
+    for (int i = 0; i < 100; ++i) {
+        keys.push_back("a_reasonably_long_key_" + std::to_string(i));
+        d.as_object()[keys.back()] = i;
+    }
 
-    if (depth < MAX_DEPTH / 5) {
-        r = 4 + rand() % 2;
-    } else if (depth > MAX_DEPTH) {
-        r = rand() % 4;
-    } else {
-        r = rand() % 6;
+    // Keys arrive as slices of a network buffer.
+    std::string buffer;
+    std::vector<dynamic_t::string_view_t> slices;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        buffer += keys[i];
+    }
+    for (size_t i = 0, offset = 0; i < keys.size(); offset += keys[i].size(), ++i) {
+        slices.push_back(dynamic_t::string_view_t(buffer.data() + offset, keys[i].size()));
     }
 
-    if (r == 0) {
-        dest = true;
-    } else if (r == 1) {
-        dest = 1337;
-    } else if (r == 2) {
-        dest = 64813.101;
-    } else if (r == 3) {
-        std::string s;
-        size_t size = rand() % (10 * BASE_SIZE);
-        s.reserve(size);
-        for (size_t i = 0; i < size; ++i) {
-            s.push_back(char(30 + rand() % 30));
+    const dynamic_t::object_t& object = d.as_object();
+
+    clock_t start = clock();
+
+    int64_t copied = 0;
+    for (int i = 0; i < 100000; ++i) {
+        for (size_t j = 0; j < slices.size(); ++j) {
+            copied += object.find(std::string(slices[j].data(), slices[j].size()))->second.as_int();
         }
-        dest = std::move(s);
-    } else if (r == 4) {
-        std::vector<dynamic_t> v;
-        size_t size = rand() % (BASE_SIZE / 10);
-        v.reserve(size);
-        for (size_t i = 0; i < size; ++i) {
-            dynamic_t d;
-            fill_dynamic(d, depth + 1);
-            v.emplace_back(std::move(d));
+    }
+
+    std::cout << "std::string key time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
+
+    int64_t viewed = 0;
+    for (int i = 0; i < 100000; ++i) {
+        for (size_t j = 0; j < slices.size(); ++j) {
+            viewed += object.find(slices[j])->second.as_int();
         }
-        dest = std::move(v);
-    } else if (r == 5) {
-        dynamic_t::object_t obj;
+    }
 
-        for (size_t i = 0; i < size_t(rand() % (BASE_SIZE / 10)); ++i) {
-            std::string key;
-            size_t size = rand() % BASE_SIZE;
-            key.reserve(size);
-            for (size_t i = 0; i < size; ++i) {
-                key.push_back(char(30 + rand() % 30));
-            }
+    std::cout << "string view key time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+
+    assert(copied == viewed);
+}
 
-            dynamic_t d;
-            fill_dynamic(d, depth + 1);
+void
+test_emplace_performance() {
+    std::cout << "Start emplace perfomance test" << std::endl;
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < 1000; ++i) {
+        keys.push_back("key" + std::to_string(i));
+    }
+
+    clock_t start = clock();
 
-            obj[key] = std::move(d);
+    size_t assigned = 0;
+    for (int i = 0; i < 1000; ++i) {
+        dynamic_t array = dynamic_t::array_t();
+        dynamic_t object = dynamic_t::object_t();
+
+        for (size_t j = 0; j < keys.size(); ++j) {
+            array.as_array().push_back(dynamic_t());
+            array.as_array().back() = keys[j];
+
+            dynamic_t value = std::vector<int>(4, j);
+            object.as_object()[keys[j]] = std::move(value);
         }
 
-        dest = std::move(obj);
+        assigned += array.as_array().size() + object.as_object().size();
     }
-}
 
-struct dynamic_walker :
-    public boost::static_visitor<>
-{
-    dynamic_walker() :
-        m_nulls(0),
-        m_bools(0),
-        m_ints(0),
-        m_doubles(0),
-        m_strings(0),
-        m_arrays(0),
-        m_objects(0)
-    {
-        // pass
+    std::cout << "push_back and assignment time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
+
+    size_t emplaced = 0;
+    for (int i = 0; i < 1000; ++i) {
+        dynamic_t array;
+        dynamic_t object;
+
+        array.reserve(keys.size());
+
+        for (size_t j = 0; j < keys.size(); ++j) {
+            array.emplace_back(keys[j]);
+            object.try_emplace(keys[j], std::vector<int>(4, j));
+        }
+
+        emplaced += array.as_array().size() + object.as_object().size();
     }
 
-    void
-    operator()(const dynamic_t::null_t&) {
-        ++m_nulls;
+    std::cout << "emplace time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+
+    assert(assigned == emplaced);
+}
+
+void
+test_builder_performance() {
+    srand(1337);
+
+    std::cout << "Start builder perfomance test" << std::endl;
+
+    clock_t start = clock();
+
+    dynamic_t d;
+    fill_dynamic(d, 0);
+
+    std::cout << "random document generation time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(buffer);
+    cocaine::io::type_traits<dynamic_t>::pack(packer, d);
+
+    std::ostringstream json;
+    cocaine::io::json_writer_t<std::ostringstream> writer(json);
+    emit(d, writer);
+    const std::string text = json.str();
+
+    start = clock();
+
+    for (int i = 0; i < 10; ++i) {
+        cocaine::framework::unpack<dynamic_t>(buffer.data(), buffer.size());
     }
 
-    void
-    operator()(const dynamic_t::bool_t&) {
-        ++m_bools;
+    std::cout << "msgpack unpack time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
+
+    for (int i = 0; i < 10; ++i) {
+        cocaine::io::json_view_t(text).materialize();
     }
 
-    void
-    operator()(const dynamic_t::int_t&) {
-        ++m_ints;
+    std::cout << "json materialize time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+
+    assert(cocaine::io::json_view_t(text).materialize() == cocaine::framework::unpack<dynamic_t>(buffer.data(), buffer.size()));
+}
+
+void
+test_snapshot_performance() {
+    std::cout << "Start snapshot perfomance test" << std::endl;
+
+    dynamic_t config = dynamic_t::object_t();
+    for (int i = 0; i < 100; ++i) {
+        config.as_object()["key" + std::to_string(i)] = i;
     }
 
-    void
-    operator()(const dynamic_t::double_t&) {
-        ++m_doubles;
+    typedef std::chrono::steady_clock clock_type;
+
+    const size_t threads = std::max(4u, std::thread::hardware_concurrency());
+    const int reads = 1000000;
+
+    // Runs the readers while the config is republished and returns the wall time.
+    auto measure = [&](std::function<int(size_t)> read, std::function<void()> publish) -> double {
+        std::atomic<bool> stopped(false);
+        std::atomic<long> checksum(0);
+        std::vector<std::thread> readers;
+
+        auto start = clock_type::now();
+
+        for (size_t i = 0; i < threads; ++i) {
+            readers.emplace_back([&read, &checksum, i] {
+                long sum = 0;
+                for (int j = 0; j < reads; ++j) {
+                    sum += read(i);
+                }
+                checksum += sum;
+            });
+        }
+
+        std::thread writer([&publish, &stopped] {
+            while (!stopped) {
+                publish();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+
+        for (auto it = readers.begin(); it != readers.end(); ++it) {
+            it->join();
+        }
+
+        const double time = std::chrono::duration<double>(clock_type::now() - start).count();
+
+        stopped = true;
+        writer.join();
+
+        assert(checksum == static_cast<long>(threads) * reads * 42);
+        return time;
+    };
+
+    std::mutex mutex;
+    std::shared_ptr<const dynamic_t> shared = std::make_shared<const dynamic_t>(config);
+
+    const double locked = measure(
+        [&mutex, &shared](size_t) {
+            std::shared_ptr<const dynamic_t> current;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                current = shared;
+            }
+            return current->as_object().at("key42").as_int();
+        },
+        [&mutex, &shared, &config] {
+            std::shared_ptr<const dynamic_t> next = std::make_shared<const dynamic_t>(config);
+            std::lock_guard<std::mutex> lock(mutex);
+            shared = next;
+        }
+    );
+
+    std::cout << threads << " threads, mutex and shared_ptr time: " << locked << std::endl;
+
+    dynamic_snapshot_t snapshot(config);
+    std::vector<std::unique_ptr<dynamic_snapshot_t::reader_t>> registrations;
+    for (size_t i = 0; i < threads; ++i) {
+        registrations.emplace_back(new dynamic_snapshot_t::reader_t(snapshot));
     }
 
-    void
-    operator()(const dynamic_t::string_t&) {
-        ++m_strings;
+    const double snapshotted = measure(
+        [&registrations](size_t i) {
+            dynamic_snapshot_t::guard_t guard(*registrations[i]);
+            return guard->as_object().at("key42").as_int();
+        },
+        [&snapshot, &config] {
+            snapshot.publish(config);
+        }
+    );
+
+    std::cout << threads << " threads, snapshot time: " << snapshotted << std::endl;
+}
+
+void
+test_concurrent_performance() {
+    std::cout << "Start concurrent builder perfomance test" << std::endl;
+
+    const int members = 1000000;
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < members; ++i) {
+        keys.push_back("key" + std::to_string((i * 7919LL) % members));
     }
 
-    void
-    operator()(const dynamic_t::array_t& v) {
-        ++m_arrays;
+    typedef std::chrono::steady_clock clock_type;
 
-        for (auto it = v.begin(); it != v.end(); ++it) {
-            it->apply(*this);
+    thread_pool_t pool;
+
+    for (size_t threads = 1; threads <= std::max(4u, std::thread::hardware_concurrency()); threads *= 2) {
+        // Every producer takes its part of the keys.
+        auto produce = [&keys, threads](std::function<void(size_t, size_t)> insert) {
+            std::vector<std::thread> producers;
+
+            for (size_t i = 0; i < threads; ++i) {
+                producers.emplace_back([&keys, &insert, threads, i] {
+                    for (size_t j = i; j < keys.size(); j += threads) {
+                        insert(i, j);
+                    }
+                });
+            }
+
+            for (auto it = producers.begin(); it != producers.end(); ++it) {
+                it->join();
+            }
+        };
+
+        auto start = clock_type::now();
+
+        std::mutex mutex;
+        dynamic_t locked = dynamic_t::object_t();
+
+        produce([&mutex, &locked, &keys](size_t, size_t j) {
+            std::lock_guard<std::mutex> lock(mutex);
+            locked.as_object()[keys[j]] = static_cast<int>(j);
+        });
+
+        const double mutex_time = std::chrono::duration<double>(clock_type::now() - start).count();
+        start = clock_type::now();
+
+        concurrent_builder_t builder;
+        std::vector<concurrent_builder_t::shard_t*> shards;
+        for (size_t i = 0; i < threads; ++i) {
+            shards.push_back(&builder.acquire());
         }
+
+        produce([&shards, &keys](size_t i, size_t j) {
+            shards[i]->insert(keys[j], static_cast<int>(j));
+        });
+
+        dynamic_t built = builder.build(pool);
+
+        const double builder_time = std::chrono::duration<double>(clock_type::now() - start).count();
+        assert(built == locked);
+
+        std::cout << threads << " threads: mutex time " << mutex_time << ", concurrent builder time " << builder_time << std::endl;
     }
+}
 
-    void
-    operator()(const dynamic_t::object_t& v) {
-        ++m_objects;
+void
+test_reclaim_performance() {
+    std::cout << "Start reclaim perfomance test" << std::endl;
 
-        for (auto it = v.begin(); it != v.end(); ++it) {
-            it->second.apply(*this);
-        }
+    dynamic_t d;
+    fill_dynamic(d, 0);
+
+    typedef std::chrono::steady_clock clock_type;
+
+    reclaimer_t reclaimer;
+
+    double inline_time = 0;
+    double inline_worst = 0;
+    double retire_time = 0;
+    double retire_worst = 0;
+
+    for (int i = 0; i < 20; ++i) {
+        dynamic_t first = d;
+        dynamic_t second = d;
+
+        auto start = clock_type::now();
+        first = dynamic_t();
+        const double destroy = std::chrono::duration<double>(clock_type::now() - start).count();
+
+        start = clock_type::now();
+        reclaimer.retire(second);
+        const double retire = std::chrono::duration<double>(clock_type::now() - start).count();
+
+        inline_time += destroy;
+        inline_worst = std::max(inline_worst, destroy);
+        retire_time += retire;
+        retire_worst = std::max(retire_worst, retire);
+
+        reclaimer.drain();
     }
 
-public:
-    size_t m_nulls;
-    size_t m_bools;
-    size_t m_ints;
-    size_t m_doubles;
-    size_t m_strings;
-    size_t m_arrays;
-    size_t m_objects;
-};
+    std::cout << "destructor time: " << inline_time << ", worst " << inline_worst << std::endl;
+    std::cout << "retire time: " << retire_time << ", worst " << retire_worst << std::endl;
+}
 
 void
-test_dynamic_performance() {
-    srand(1337);
+compare_encodings(const dynamic_t& d) {
+    clock_t start = clock();
 
-    dynamic_t d;
+    msgpack::sbuffer buffer;
+    for (int i = 0; i < 10; ++i) {
+        buffer.clear();
+        msgpack::packer<msgpack::sbuffer> packer(buffer);
+        cocaine::io::type_traits<dynamic_t>::pack(packer, d);
+    }
 
-    std::cout << "Start dynamic perfomance test" << std::endl;
+    std::cout << "msgpack pack time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
 
-    fill_dynamic(d, 0);
+    for (int i = 0; i < 10; ++i) {
+        cocaine::framework::unpack<dynamic_t>(buffer.data(), buffer.size());
+    }
 
-    std::cout << "dynamic object has been filled" << std::endl;
+    std::cout << "msgpack unpack time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
 
-    time_t now = time(0);
+    std::string encoded;
+    for (int i = 0; i < 10; ++i) {
+        encoded.clear();
+        cocaine::io::compact_encode(d, encoded);
+    }
+
+    std::cout << "compact encode time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
 
     for (int i = 0; i < 10; ++i) {
-        dynamic_walker w;
-        d.apply(w);
+        cocaine::io::compact_decode(encoded);
     }
 
-    std::cout << "Walk time: " << (time(0) - now) << std::endl;
+    std::cout << "compact decode time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
 
-    dynamic_walker w;
+    assert(cocaine::io::compact_decode(encoded) == d);
 
-    d.apply(w);
+    std::cout << "SIZE: msgpack " << buffer.size() << ", compact " << encoded.size() << std::endl;
+}
 
-    std::cout << "STAT: "
-              << w.m_nulls << ", "
-              << w.m_bools << ", "
-              << w.m_ints << ", "
-              << w.m_doubles << ", "
-              << w.m_strings << ", "
-              << w.m_arrays << ", "
-              << w.m_objects << std::endl;
+void
+test_compact_performance() {
+    srand(1337);
+
+    dynamic_t d;
+
+    std::cout << "Start compact encoding perfomance test" << std::endl;
+
+    fill_dynamic(d, 0);
+
+    std::cout << "Random document:" << std::endl;
+    compare_encodings(d);
+
+    dynamic_t::array_t records;
+    records.reserve(100000);
+    for (int i = 0; i < 100000; ++i) {
+        dynamic_t record;
+        record.as_object()["identifier"] = i;
+        record.as_object()["status"] = std::string(i % 3 ? "active" : "disabled");
+        record.as_object()["weight"] = i * 0.5;
+        record.as_object()["created_timestamp"] = 1400000000 + i;
+        records.push_back(record);
+    }
+
+    std::cout << "Same-shaped records:" << std::endl;
+    compare_encodings(records);
 }
 
 void
@@ -441,6 +2933,73 @@ enum myen {
     case3
 };
 
+void
+test_patch_performance() {
+    srand(1337);
+
+    dynamic_t d;
+
+    std::cout << "Start patch perfomance test" << std::endl;
+
+    fill_dynamic(d, 0);
+
+    // A few small edits deep inside the document.
+    dynamic_t edited = d;
+    for (int i = 0; i < 10; ++i) {
+        dynamic_t *node = &edited;
+
+        while (node->is_object() || node->is_array()) {
+            if (node->is_object()) {
+                dynamic_t::object_t& object = node->as_object();
+
+                if (object.empty()) {
+                    break;
+                }
+
+                auto it = object.begin();
+                std::advance(it, rand() % object.size());
+                node = &it->second;
+            } else {
+                dynamic_t::array_t& array = node->as_array();
+
+                if (array.empty()) {
+                    break;
+                }
+
+                node = &array[rand() % array.size()];
+            }
+        }
+
+        *node = i;
+    }
+
+    clock_t start = clock();
+
+    dynamic_t patch;
+    for (int i = 0; i < 10; ++i) {
+        patch = diff(d, edited);
+    }
+
+    std::cout << "diff time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+    start = clock();
+
+    for (int i = 0; i < 10; ++i) {
+        dynamic_t copy = d;
+    }
+
+    std::cout << "copy time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+
+    dynamic_t target = d;
+    start = clock();
+    apply_patch(target, patch);
+    std::cout << "apply time: " << double(clock() - start) / CLOCKS_PER_SEC << std::endl;
+
+    assert(target == edited);
+
+    std::cout << "SIZE: patch " << cocaine::io::compact_encode(patch).size()
+              << ", document " << cocaine::io::compact_encode(edited).size() << std::endl;
+}
+
 int
 main() {
 //#define PERFORM_PERFORMANCE_TEST
@@ -451,6 +3010,23 @@ main() {
 //    }
 
     //test_dynamic_performance();
+    //test_compact_performance();
+    //test_patch_performance();
+    //test_traverse_performance();
+    //test_visit_performance();
+    //test_parallel_performance();
+    //test_query_performance();
+    //test_index_performance();
+    //test_try_to_performance();
+    //test_view_performance();
+    //test_reflect_performance();
+    //test_numeric_performance();
+    //test_string_view_performance();
+    //test_emplace_performance();
+    //test_builder_performance();
+    //test_snapshot_performance();
+    //test_concurrent_performance();
+    //test_reclaim_performance();
     test_json_performance();
 
     return 0;
@@ -661,6 +3237,31 @@ main() {
     }
 
     test_msgpack();
+    test_reader();
+    test_transcode();
+    test_json_view();
+    test_compact();
+    test_mapped();
+    test_path();
+    test_hash();
+    test_dedup();
+    test_patch();
+    test_merge();
+    test_traverse();
+    test_visit();
+    test_parallel();
+    test_query();
+    test_index();
+    test_try_to();
+    test_view();
+    test_reflect();
+    test_numeric();
+    test_string_view();
+    test_emplace();
+    test_builder();
+    test_snapshot();
+    test_concurrent();
+    test_reclaim();
 
     return 0;
 }
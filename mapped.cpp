@@ -0,0 +1,521 @@
+#include "mapped.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace cocaine;
+using namespace cocaine::io;
+
+namespace {
+
+const char magic[8] = { 'D', 'Y', 'N', 'M', 'A', 'P', 0, 1 };
+
+// The file starts with the magic and the offset of the root node.
+const size_t header_size = 16;
+
+enum type_t {
+    null_type,
+    bool_type,
+    int_type,
+    double_type,
+    string_type,
+    array_type,
+    object_type
+};
+
+struct node_t {
+    uint32_t type;
+    uint32_t reserved;
+
+    // Scalar value (doubles are stored bitwise) or size of the node.
+    uint64_t slot;
+};
+
+class writer_t :
+    public boost::static_visitor<uint64_t>
+{
+public:
+    writer_t(std::string& output) :
+        m_output(output),
+        m_base(output.size())
+    {
+        // pass
+    }
+
+    void
+    write(const dynamic_t& source) {
+        m_output.append(magic, sizeof(magic));
+        m_output.append(8, '\0');
+
+        const uint64_t root = source.apply(*this);
+        patch(header_size - 8, root);
+    }
+
+    uint64_t
+    operator()(const dynamic_t::null_t&) {
+        return write_node(null_type, 0);
+    }
+
+    uint64_t
+    operator()(const dynamic_t::bool_t& v) {
+        return write_node(bool_type, v ? 1 : 0);
+    }
+
+    uint64_t
+    operator()(const dynamic_t::int_t& v) {
+        return write_node(int_type, static_cast<uint64_t>(v));
+    }
+
+    uint64_t
+    operator()(const dynamic_t::double_t& v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        return write_node(double_type, bits);
+    }
+
+    uint64_t
+    operator()(const dynamic_t::string_t& v) {
+        const uint64_t offset = write_node(string_type, v.size());
+        m_output.append(v.data(), v.size() + 1);
+        return offset;
+    }
+
+    uint64_t
+    operator()(const dynamic_t::array_t& v) {
+        const uint64_t offset = write_node(array_type, v.size());
+        const uint64_t table = reserve(v.size());
+
+        for (size_t i = 0; i < v.size(); ++i) {
+            patch(table + 8 * i, v[i].apply(*this));
+        }
+
+        return offset;
+    }
+
+    uint64_t
+    operator()(const dynamic_t::object_t& v) {
+        const uint64_t offset = write_node(object_type, v.size());
+        const uint64_t table = reserve(2 * v.size());
+
+        // object_t is sorted by std::string comparison, which is what the reader uses for the binary search.
+        size_t index = 0;
+
+        for (auto it = v.begin(); it != v.end(); ++it, ++index) {
+            patch(table + 16 * index, write_key(it->first));
+            patch(table + 16 * index + 8, it->second.apply(*this));
+        }
+
+        return offset;
+    }
+
+private:
+    uint64_t
+    write_key(const std::string& key) {
+        auto it = m_keys.find(key);
+
+        if (it != m_keys.end()) {
+            return it->second;
+        }
+
+        const uint64_t offset = (*this)(key);
+        m_keys.insert(std::make_pair(key, offset));
+        return offset;
+    }
+
+    // Appends a node and returns its offset from the beginning of the document.
+    uint64_t
+    write_node(uint32_t type, uint64_t slot) {
+        align();
+
+        node_t node;
+        std::memset(&node, 0, sizeof(node));
+        node.type = type;
+        node.slot = slot;
+
+        const uint64_t offset = m_output.size() - m_base;
+        m_output.append(reinterpret_cast<const char*>(&node), sizeof(node));
+        return offset;
+    }
+
+    // Reserves a table of 8-byte entries and returns its offset.
+    uint64_t
+    reserve(size_t entries) {
+        const uint64_t offset = m_output.size() - m_base;
+        m_output.append(8 * entries, '\0');
+        return offset;
+    }
+
+    void
+    patch(uint64_t offset, uint64_t value) {
+        std::memcpy(&m_output[m_base + offset], &value, sizeof(value));
+    }
+
+    void
+    align() {
+        m_output.append((8 - (m_output.size() - m_base) % 8) % 8, '\0');
+    }
+
+private:
+    std::string& m_output;
+    const size_t m_base;
+
+    std::unordered_map<std::string, uint64_t> m_keys;
+};
+
+} // namespace
+
+void
+io::mapped_write(const dynamic_t& source, std::string& output) {
+    writer_t(output).write(source);
+}
+
+void
+io::mapped_write(const dynamic_t& source, const std::string& path) {
+    std::string buffer;
+    mapped_write(source, buffer);
+
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    file.write(buffer.data(), buffer.size());
+
+    if (!file) {
+        throw mapped_error("unable to write " + path);
+    }
+}
+
+mapped_view_t::mapped_view_t(const char *data, size_t size) :
+    m_data(data),
+    m_size(size),
+    m_offset(0)
+{
+    if (size < header_size || std::memcmp(data, magic, sizeof(magic)) != 0) {
+        throw mapped_error("invalid document header");
+    }
+
+    uint64_t root;
+    std::memcpy(&root, data + sizeof(magic), sizeof(root));
+
+    *this = child(root);
+}
+
+mapped_view_t::mapped_view_t(const char *data, size_t size, uint64_t offset) :
+    m_data(data),
+    m_size(size),
+    m_offset(offset)
+{
+    // pass
+}
+
+bool
+mapped_view_t::is_null() const {
+    return type() == null_type;
+}
+
+bool
+mapped_view_t::is_bool() const {
+    return type() == bool_type;
+}
+
+bool
+mapped_view_t::is_int() const {
+    return type() == int_type;
+}
+
+bool
+mapped_view_t::is_double() const {
+    return type() == double_type;
+}
+
+bool
+mapped_view_t::is_string() const {
+    return type() == string_type;
+}
+
+bool
+mapped_view_t::is_array() const {
+    return type() == array_type;
+}
+
+bool
+mapped_view_t::is_object() const {
+    return type() == object_type;
+}
+
+dynamic_t::bool_t
+mapped_view_t::as_bool() const {
+    if (!is_bool()) {
+        throw boost::bad_get();
+    }
+
+    return slot() != 0;
+}
+
+dynamic_t::int_t
+mapped_view_t::as_int() const {
+    if (!is_int()) {
+        throw boost::bad_get();
+    }
+
+    return static_cast<dynamic_t::int_t>(slot());
+}
+
+dynamic_t::double_t
+mapped_view_t::as_double() const {
+    if (!is_double()) {
+        throw boost::bad_get();
+    }
+
+    const uint64_t bits = slot();
+
+    dynamic_t::double_t result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+const char*
+mapped_view_t::as_string() const {
+    if (!is_string()) {
+        throw boost::bad_get();
+    }
+
+    if (slot() >= m_size - m_offset - sizeof(node_t)) {
+        throw mapped_error("string is out of bounds");
+    }
+
+    return m_data + m_offset + sizeof(node_t);
+}
+
+size_t
+mapped_view_t::size() const {
+    if (!is_string() && !is_array() && !is_object()) {
+        throw boost::bad_get();
+    }
+
+    return slot();
+}
+
+mapped_view_t
+mapped_view_t::at(size_t index) const {
+    if (!is_array()) {
+        throw boost::bad_get();
+    }
+
+    if (index >= slot()) {
+        throw std::out_of_range("mapped_view_t::at");
+    }
+
+    return child(table(slot())[index]);
+}
+
+mapped_view_t
+mapped_view_t::at(const std::string& key) const {
+    mapped_view_t result(*this);
+
+    if (!find(key.data(), key.size(), result)) {
+        throw std::out_of_range("mapped_view_t::at");
+    }
+
+    return result;
+}
+
+mapped_view_t
+mapped_view_t::at(const std::string& key, const mapped_view_t& def) const {
+    mapped_view_t result(*this);
+
+    if (!find(key.data(), key.size(), result)) {
+        return def;
+    }
+
+    return result;
+}
+
+mapped_view_t
+mapped_view_t::operator[](size_t index) const {
+    return at(index);
+}
+
+mapped_view_t
+mapped_view_t::operator[](const std::string& key) const {
+    return at(key);
+}
+
+const char*
+mapped_view_t::key_at(size_t index) const {
+    if (!is_object()) {
+        throw boost::bad_get();
+    }
+
+    if (index >= slot()) {
+        throw std::out_of_range("mapped_view_t::key_at");
+    }
+
+    return child(table(2 * slot())[2 * index]).as_string();
+}
+
+mapped_view_t
+mapped_view_t::value_at(size_t index) const {
+    if (!is_object()) {
+        throw boost::bad_get();
+    }
+
+    if (index >= slot()) {
+        throw std::out_of_range("mapped_view_t::value_at");
+    }
+
+    return child(table(2 * slot())[2 * index + 1]);
+}
+
+dynamic_t
+mapped_view_t::materialize() const {
+    switch (type()) {
+    case bool_type:
+        return as_bool();
+
+    case int_type:
+        return as_int();
+
+    case double_type:
+        return as_double();
+
+    case string_type:
+        return std::string(as_string(), size());
+
+    case array_type: {
+        dynamic_t::array_t result;
+        result.reserve(size());
+
+        for (size_t i = 0; i < size(); ++i) {
+            result.push_back(at(i).materialize());
+        }
+
+        return result;
+    }
+
+    case object_type: {
+        dynamic_t::object_t result;
+
+        const uint64_t *entries = table(2 * size());
+
+        for (size_t i = 0; i < size(); ++i) {
+            const mapped_view_t key = child(entries[2 * i]);
+            result.emplace_hint(result.end(), std::string(key.as_string(), key.size()), child(entries[2 * i + 1]).materialize());
+        }
+
+        return result;
+    }
+
+    default:
+        return dynamic_t();
+    }
+}
+
+uint32_t
+mapped_view_t::type() const {
+    return reinterpret_cast<const node_t*>(m_data + m_offset)->type;
+}
+
+uint64_t
+mapped_view_t::slot() const {
+    return reinterpret_cast<const node_t*>(m_data + m_offset)->slot;
+}
+
+const uint64_t*
+mapped_view_t::table(uint64_t entries) const {
+    if (entries > (m_size - m_offset - sizeof(node_t)) / 8) {
+        throw mapped_error("table is out of bounds");
+    }
+
+    return reinterpret_cast<const uint64_t*>(m_data + m_offset + sizeof(node_t));
+}
+
+mapped_view_t
+mapped_view_t::child(uint64_t offset) const {
+    if (offset % 8 != 0 || offset < header_size || offset > m_size - sizeof(node_t)) {
+        throw mapped_error("invalid node offset");
+    }
+
+    return mapped_view_t(m_data, m_size, offset);
+}
+
+bool
+mapped_view_t::find(const char *key, size_t size, mapped_view_t& result) const {
+    if (!is_object()) {
+        throw boost::bad_get();
+    }
+
+    const uint64_t *entries = table(2 * slot());
+    size_t first = 0, last = slot();
+
+    // Lower bound in terms of std::string comparison: bytes first, then length.
+    while (first < last) {
+        const size_t middle = first + (last - first) / 2;
+        const mapped_view_t candidate = child(entries[2 * middle]);
+        const size_t candidate_size = candidate.size();
+
+        int compare = std::memcmp(candidate.as_string(), key, std::min(candidate_size, size));
+
+        if (compare == 0) {
+            if (candidate_size == size) {
+                result = child(entries[2 * middle + 1]);
+                return true;
+            }
+
+            compare = candidate_size < size ? -1 : 1;
+        }
+
+        if (compare < 0) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+
+    return false;
+}
+
+mapped_file_t::mapped_file_t(const std::string& path) :
+    m_data(MAP_FAILED),
+    m_size(0)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd == -1) {
+        throw std::system_error(errno, std::system_category(), "unable to open " + path);
+    }
+
+    struct stat info;
+
+    if (::fstat(fd, &info) == -1) {
+        const int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::system_category(), "unable to stat " + path);
+    }
+
+    m_size = info.st_size;
+    m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    // The mapping stays valid after the descriptor is closed.
+    const int error = errno;
+    ::close(fd);
+
+    if (m_data == MAP_FAILED) {
+        throw std::system_error(error, std::system_category(), "unable to map " + path);
+    }
+}
+
+mapped_file_t::~mapped_file_t() {
+    ::munmap(m_data, m_size);
+}
+
+mapped_view_t
+mapped_file_t::root() const {
+    return mapped_view_t(static_cast<const char*>(m_data), m_size);
+}
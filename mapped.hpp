@@ -0,0 +1,161 @@
+#ifndef COCAINE_DYNAMIC_MAPPED_HPP
+#define COCAINE_DYNAMIC_MAPPED_HPP
+
+#include "dynamic.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace cocaine { namespace io {
+
+// Read-only document format which can be used straight from memory without parsing.
+//
+// Every value is an 8-byte aligned node: a type tag followed by an 8-byte slot which holds either
+// a scalar or the size of a string or container. Strings follow the node with a terminating zero,
+// arrays follow it with a table of absolute offsets of their elements, objects with a table of
+// (key offset, value offset) pairs sorted by key, so members are found with a binary search.
+// Each distinct key is stored once. Numbers are stored in the byte order of the writing host.
+
+struct mapped_error :
+    public std::runtime_error
+{
+    mapped_error(const std::string& message) :
+        std::runtime_error(message)
+    {
+        // pass
+    }
+};
+
+// Appends the serialized document to the output.
+void
+mapped_write(const dynamic_t& source, std::string& output);
+
+void
+mapped_write(const dynamic_t& source, const std::string& path);
+
+// View of a value in a serialized document. Views are plain pointers into the document,
+// they never allocate and must not outlive the memory they point into.
+// Type mismatches throw boost::bad_get like dynamic_t does.
+class mapped_view_t {
+public:
+    // The data must be 8-byte aligned, like memory returned by mmap or operator new.
+    mapped_view_t(const char *data, size_t size);
+
+    bool
+    is_null() const;
+
+    bool
+    is_bool() const;
+
+    bool
+    is_int() const;
+
+    bool
+    is_double() const;
+
+    bool
+    is_string() const;
+
+    bool
+    is_array() const;
+
+    bool
+    is_object() const;
+
+    dynamic_t::bool_t
+    as_bool() const;
+
+    dynamic_t::int_t
+    as_int() const;
+
+    dynamic_t::double_t
+    as_double() const;
+
+    // Null-terminated string, its length is returned by size().
+    const char*
+    as_string() const;
+
+    // Length of a string, number of elements of an array or members of an object.
+    size_t
+    size() const;
+
+    // Element of an array. Throws std::out_of_range if there is no such element.
+    mapped_view_t
+    at(size_t index) const;
+
+    // Member of an object. Throws std::out_of_range if there is no such key.
+    mapped_view_t
+    at(const std::string& key) const;
+
+    mapped_view_t
+    at(const std::string& key, const mapped_view_t& def) const;
+
+    mapped_view_t
+    operator[](size_t index) const;
+
+    mapped_view_t
+    operator[](const std::string& key) const;
+
+    // Key of the index-th member of an object in the sorted order.
+    const char*
+    key_at(size_t index) const;
+
+    // Value of the index-th member of an object in the sorted order.
+    mapped_view_t
+    value_at(size_t index) const;
+
+    // Copies the whole subtree into dynamic_t.
+    dynamic_t
+    materialize() const;
+
+private:
+    mapped_view_t(const char *data, size_t size, uint64_t offset);
+
+    uint32_t
+    type() const;
+
+    // Scalar value or size of the node.
+    uint64_t
+    slot() const;
+
+    // Table of offsets which follows a container node.
+    const uint64_t*
+    table(uint64_t entries) const;
+
+    mapped_view_t
+    child(uint64_t offset) const;
+
+    bool
+    find(const char *key, size_t size, mapped_view_t& result) const;
+
+private:
+    const char *m_data;
+    size_t m_size;
+    uint64_t m_offset;
+};
+
+// Maps a serialized document file into memory. Pages are shared with other processes through the page cache.
+class mapped_file_t {
+public:
+    explicit
+    mapped_file_t(const std::string& path);
+
+    ~mapped_file_t();
+
+    mapped_view_t
+    root() const;
+
+private:
+    mapped_file_t(const mapped_file_t&);
+
+    mapped_file_t&
+    operator=(const mapped_file_t&);
+
+private:
+    void *m_data;
+    size_t m_size;
+};
+
+}} // namespace cocaine::io
+
+#endif // COCAINE_DYNAMIC_MAPPED_HPP
@@ -0,0 +1,99 @@
+#include "merge.hpp"
+
+#include <algorithm>
+
+using namespace cocaine;
+
+namespace {
+
+// Overlay is either const dynamic_t or dynamic_t, values are copied or moved accordingly.
+template<class Overlay>
+struct merger {
+    typedef typename std::conditional<
+        std::is_const<Overlay>::value,
+        const dynamic_t&,
+        dynamic_t&&
+    >::type value_reference;
+
+    static
+    value_reference
+    take(Overlay& value) {
+        return static_cast<value_reference>(value);
+    }
+
+    static
+    void
+    merge(dynamic_t& base, Overlay& overlay, array_merge_t policy) {
+        if (base.is_object() && overlay.is_object()) {
+            merge_objects(base.as_object(), overlay.as_object(), policy);
+        } else if (base.is_array() && overlay.is_array() && policy != array_merge_t::replace) {
+            merge_arrays(base.as_array(), overlay.as_array(), policy);
+        } else {
+            base = take(overlay);
+        }
+    }
+
+    template<class Object>
+    static
+    void
+    merge_objects(dynamic_t::object_t& base, Object& overlay, array_merge_t policy) {
+        if (base.empty()) {
+            base = take_object(overlay);
+            return;
+        }
+
+        auto b = base.begin();
+
+        for (auto o = overlay.begin(); o != overlay.end(); ++o) {
+            while (b != base.end() && b->first < o->first) {
+                ++b;
+            }
+
+            if (b != base.end() && b->first == o->first) {
+                merge(b->second, o->second, policy);
+                ++b;
+            } else {
+                // The hint is right before the next greater key, so the insertion is amortized constant.
+                base.emplace_hint(b, o->first, take(o->second));
+            }
+        }
+    }
+
+    template<class Array>
+    static
+    void
+    merge_arrays(dynamic_t::array_t& base, Array& overlay, array_merge_t policy) {
+        const size_t size = base.size();
+        base.reserve(size + overlay.size());
+
+        for (auto it = overlay.begin(); it != overlay.end(); ++it) {
+            if (policy == array_merge_t::concat || std::find(base.begin(), base.begin() + size, *it) == base.begin() + size) {
+                base.push_back(take(*it));
+            }
+        }
+    }
+
+    static
+    const dynamic_t::object_t&
+    take_object(const dynamic_t::object_t& object) {
+        return object;
+    }
+
+    static
+    dynamic_t::object_t&&
+    take_object(dynamic_t::object_t& object) {
+        return std::move(object);
+    }
+};
+
+} // namespace
+
+void
+cocaine::merge(dynamic_t& base, dynamic_t&& overlay, array_merge_t policy) {
+    merger<dynamic_t>::merge(base, overlay, policy);
+}
+
+void
+cocaine::merge(dynamic_t& base, const dynamic_t& overlay, array_merge_t policy) {
+    merger<const dynamic_t>::merge(base, overlay, policy);
+}
@@ -0,0 +1,30 @@
+#ifndef COCAINE_DYNAMIC_MERGE_HPP
+#define COCAINE_DYNAMIC_MERGE_HPP
+
+#include "dynamic.hpp"
+
+namespace cocaine {
+
+// What to do when both sides of a merge have an array at the same place.
+enum class array_merge_t {
+    // The overlay array replaces the base one.
+    replace,
+    // Elements of the overlay which the base array doesn't contain yet are appended to it.
+    append,
+    // All elements of the overlay are appended to the base array.
+    concat
+};
+
+// Merges the overlay into the base: objects are merged recursively, arrays according to the policy,
+// everything else in the overlay replaces the base value. Keys of both objects are walked in a single pass,
+// since object_t keeps them sorted.
+// The rvalue overload steals subtrees from the overlay instead of copying them.
+void
+merge(dynamic_t& base, dynamic_t&& overlay, array_merge_t policy = array_merge_t::replace);
+
+void
+merge(dynamic_t& base, const dynamic_t& overlay, array_merge_t policy = array_merge_t::replace);
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_MERGE_HPP
@@ -0,0 +1,64 @@
+#include "numeric.hpp"
+
+#include <algorithm>
+
+using namespace cocaine;
+
+namespace {
+
+// Reads the value of a number and tells its type with a single dispatch.
+struct number_reader_t {
+    detail::dynamic::number_kind_t
+    operator()(const dynamic_t::int_t& value) {
+        int_value = value;
+        return detail::dynamic::int_run;
+    }
+
+    detail::dynamic::number_kind_t
+    operator()(const dynamic_t::double_t& value) {
+        double_value = value;
+        return detail::dynamic::double_run;
+    }
+
+    template<class T>
+    detail::dynamic::number_kind_t
+    operator()(const T&) {
+        return detail::dynamic::not_a_number;
+    }
+
+    int64_t int_value;
+    double double_value;
+};
+
+} // namespace
+
+detail::dynamic::number_kind_t
+detail::dynamic::gather_numbers(const dynamic_t::array_t& from,
+                                size_t offset,
+                                int64_t *ints,
+                                double *doubles,
+                                size_t& count)
+{
+    const size_t last = std::min(from.size(), offset + number_chunk);
+
+    number_reader_t reader;
+    const number_kind_t kind = from[offset].visit(reader);
+
+    count = 0;
+
+    if (kind == int_run) {
+        ints[count++] = reader.int_value;
+
+        for (size_t i = offset + 1; i < last && from[i].visit(reader) == int_run; ++i) {
+            ints[count++] = reader.int_value;
+        }
+    } else if (kind == double_run) {
+        doubles[count++] = reader.double_value;
+
+        for (size_t i = offset + 1; i < last && from[i].visit(reader) == double_run; ++i) {
+            doubles[count++] = reader.double_value;
+        }
+    }
+
+    return kind;
+}
@@ -0,0 +1,220 @@
+#ifndef COCAINE_DYNAMIC_NUMERIC_HPP
+#define COCAINE_DYNAMIC_NUMERIC_HPP
+
+#include "dynamic.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace cocaine {
+
+struct numeric_error :
+    public std::runtime_error
+{
+    numeric_error(const std::string& message, size_t index) :
+        std::runtime_error(message + " at index " + std::to_string(index)),
+        m_index(index)
+    {
+        // pass
+    }
+
+    size_t
+    index() const {
+        return m_index;
+    }
+
+private:
+    size_t m_index;
+};
+
+namespace detail { namespace dynamic {
+
+    static const size_t number_chunk = 256;
+
+    enum number_kind_t {
+        int_run,
+        double_run,
+        not_a_number
+    };
+
+    // Copies the run of up to number_chunk numbers of the same type starting at the offset into the buffer
+    // for this type with a single dispatch per element. The length of the run is returned in count.
+    number_kind_t
+    gather_numbers(const cocaine::dynamic_t::array_t& from, size_t offset, int64_t *ints, double *doubles, size_t& count);
+
+    template<class T, class = void>
+    struct number_limits;
+
+    template<class T>
+    struct number_limits<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+        static
+        bool
+        in_range(int64_t) {
+            return true;
+        }
+
+        // Infinities and NaNs are kept, finite values must not overflow.
+        static
+        bool
+        in_range(double value) {
+            const double magnitude = std::fabs(value);
+            return !(magnitude > std::numeric_limits<T>::max()) || magnitude == std::numeric_limits<double>::infinity();
+        }
+    };
+
+    template<class T>
+    struct number_limits<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type> {
+        static
+        bool
+        in_range(int64_t value) {
+            return value >= std::numeric_limits<T>::min() && value <= std::numeric_limits<T>::max();
+        }
+
+        // Doubles are truncated like static_cast does, so the bounds are [-2^digits, 2^digits). NaN fails both.
+        static
+        bool
+        in_range(double value) {
+            return value >= -std::ldexp(1.0, std::numeric_limits<T>::digits) &&
+                   value < std::ldexp(1.0, std::numeric_limits<T>::digits);
+        }
+    };
+
+    template<class T>
+    struct number_limits<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type> {
+        static
+        bool
+        in_range(int64_t value) {
+            return value >= 0 && static_cast<uint64_t>(value) <= std::numeric_limits<T>::max();
+        }
+
+        static
+        bool
+        in_range(double value) {
+            return value > -1.0 && value < std::ldexp(1.0, std::numeric_limits<T>::digits);
+        }
+    };
+
+    // The range check and the conversion are separate branchless loops over a contiguous buffer,
+    // so the compiler vectorizes both of them.
+    template<class T, class Source>
+    bool
+    convert_run(const Source *source, size_t count, T *to) {
+        bool valid = true;
+
+        for (size_t i = 0; i < count; ++i) {
+            valid &= number_limits<T>::in_range(source[i]);
+        }
+
+        if (!valid) {
+            return false;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            to[i] = static_cast<T>(source[i]);
+        }
+
+        return true;
+    }
+
+    template<class T, class Source>
+    size_t
+    first_out_of_range(const Source *source) {
+        size_t index = 0;
+
+        while (number_limits<T>::in_range(source[index])) {
+            ++index;
+        }
+
+        return index;
+    }
+
+    // Returns the index of the first element which isn't a number or doesn't fit into T, or the size of the array.
+    template<class T>
+    size_t
+    convert_numbers(const cocaine::dynamic_t::array_t& from, T *to, bool& out_of_range) {
+        int64_t ints[number_chunk];
+        double doubles[number_chunk];
+
+        size_t offset = 0;
+
+        while (offset < from.size()) {
+            size_t count = 0;
+
+            switch (gather_numbers(from, offset, ints, doubles, count)) {
+            case int_run:
+                if (!convert_run(ints, count, to + offset)) {
+                    out_of_range = true;
+                    return offset + first_out_of_range<T>(ints);
+                }
+                break;
+
+            case double_run:
+                if (!convert_run(doubles, count, to + offset)) {
+                    out_of_range = true;
+                    return offset + first_out_of_range<T>(doubles);
+                }
+                break;
+
+            default:
+                out_of_range = false;
+                return offset;
+            }
+
+            offset += count;
+        }
+
+        return offset;
+    }
+
+}} // namespace detail::dynamic
+
+// Bulk conversion of an array of numbers into a vector of T, an alternative to to<std::vector<T>>() for large
+// numeric arrays. Runs of ints and of doubles are gathered into contiguous buffers and converted by vectorized
+// kernels, mixed arrays just produce shorter runs. Unlike to<T>(), every value is range-checked:
+// doubles are truncated towards zero and must fit into integral T after that, finite doubles must fit into float.
+// Throws boost::bad_get if the value isn't an array and numeric_error if an element isn't a number or doesn't fit.
+template<class T>
+std::vector<T>
+to_numbers(const dynamic_t& from) {
+    static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, "T must be a numeric type");
+
+    const dynamic_t::array_t& array = from.as_array();
+
+    std::vector<T> result(array.size());
+    bool out_of_range = false;
+
+    const size_t index = detail::dynamic::convert_numbers(array, result.data(), out_of_range);
+
+    if (index != array.size()) {
+        throw numeric_error(out_of_range ? "number is out of range" : "number expected", index);
+    }
+
+    return result;
+}
+
+// Non-throwing version. Returns false if the value isn't an array of numbers fitting into T,
+// the result is unspecified in that case.
+template<class T>
+bool
+try_to_numbers(const dynamic_t& from, std::vector<T>& result) {
+    static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, "T must be a numeric type");
+
+    if (!from.is_array()) {
+        return false;
+    }
+
+    const dynamic_t::array_t& array = from.as_array();
+    result.resize(array.size());
+
+    bool out_of_range = false;
+    return detail::dynamic::convert_numbers(array, result.data(), out_of_range) == array.size();
+}
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_NUMERIC_HPP
@@ -0,0 +1,291 @@
+#ifndef COCAINE_DYNAMIC_PACK_HPP
+#define COCAINE_DYNAMIC_PACK_HPP
+
+#include <cocaine/traits.hpp>
+
+#include "dynamic.hpp"
+#include "events.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace cocaine { namespace io {
+
+// Event handler which packs the document with msgpack::packer.
+// Sizes of containers must be known in advance.
+template<class Stream>
+class msgpack_writer_t {
+public:
+    msgpack_writer_t(msgpack::packer<Stream>& packer) :
+        m_packer(packer)
+    {
+        // pass
+    }
+
+    void
+    null_value() {
+        m_packer << msgpack::type::nil();
+    }
+
+    void
+    bool_value(dynamic_t::bool_t v) {
+        m_packer << v;
+    }
+
+    void
+    int_value(dynamic_t::int_t v) {
+        m_packer << v;
+    }
+
+    void
+    double_value(dynamic_t::double_t v) {
+        m_packer << v;
+    }
+
+    void
+    string_value(const char *data, size_t size) {
+        m_packer.pack_raw(size);
+        m_packer.pack_raw_body(data, size);
+    }
+
+    void
+    begin_array(size_t size) {
+        if (size == events::unknown_size) {
+            throw msgpack::type_error();
+        }
+
+        m_packer.pack_array(size);
+    }
+
+    void
+    end_array() {
+        // pass
+    }
+
+    void
+    begin_object(size_t size) {
+        if (size == events::unknown_size) {
+            throw msgpack::type_error();
+        }
+
+        m_packer.pack_map(size);
+    }
+
+    void
+    key(const char *data, size_t size) {
+        string_value(data, size);
+    }
+
+    void
+    end_object() {
+        // pass
+    }
+
+private:
+    msgpack::packer<Stream>& m_packer;
+};
+
+// Parses msgpack bytes and reports them to the handler token by token without building msgpack::object.
+// Memory usage is proportional to the nesting depth. Raw and binary values are reported as strings.
+template<class Handler>
+class msgpack_parser_t {
+public:
+    msgpack_parser_t(Handler& handler) :
+        m_handler(handler),
+        m_data(nullptr),
+        m_size(0),
+        m_offset(0)
+    {
+        // pass
+    }
+
+    // Parses a single msgpack value and returns the number of bytes consumed.
+    size_t
+    parse(const char *data, size_t size) {
+        m_data = data;
+        m_size = size;
+        m_offset = 0;
+        m_stack.clear();
+
+        do {
+            if (!m_stack.empty() && m_stack.back().remaining == 0) {
+                const bool is_map = m_stack.back().is_map;
+                m_stack.pop_back();
+
+                if (is_map) {
+                    m_handler.end_object();
+                } else {
+                    m_handler.end_array();
+                }
+
+                continue;
+            }
+
+            if (!m_stack.empty()) {
+                frame_t& top = m_stack.back();
+
+                // Map entries are counted twice: once for the key and once for the value.
+                if (top.is_map && top.remaining % 2 == 0) {
+                    --top.remaining;
+                    parse_key();
+                    continue;
+                }
+
+                --top.remaining;
+            }
+
+            parse_value();
+        } while (!m_stack.empty());
+
+        return m_offset;
+    }
+
+private:
+    struct frame_t {
+        bool is_map;
+        uint64_t remaining;
+    };
+
+    void
+    parse_value() {
+        const unsigned char tag = read(1)[0];
+
+        if (tag < 0x80) {
+            m_handler.int_value(tag);
+        } else if (tag >= 0xe0) {
+            m_handler.int_value(static_cast<signed char>(tag));
+        } else if ((tag & 0xf0) == 0x80) {
+            begin_map(tag & 0x0f);
+        } else if ((tag & 0xf0) == 0x90) {
+            begin_array(tag & 0x0f);
+        } else if ((tag & 0xe0) == 0xa0) {
+            string_value(tag & 0x1f);
+        } else switch (tag) {
+            case 0xc0: m_handler.null_value(); break;
+            case 0xc2: m_handler.bool_value(false); break;
+            case 0xc3: m_handler.bool_value(true); break;
+
+            case 0xca: {
+                uint32_t bits = read_uint(4);
+                float v;
+                std::memcpy(&v, &bits, sizeof(v));
+                m_handler.double_value(v);
+            } break;
+
+            case 0xcb: {
+                uint64_t bits = read_uint(8);
+                double v;
+                std::memcpy(&v, &bits, sizeof(v));
+                m_handler.double_value(v);
+            } break;
+
+            case 0xcc: m_handler.int_value(read_uint(1)); break;
+            case 0xcd: m_handler.int_value(read_uint(2)); break;
+            case 0xce: m_handler.int_value(read_uint(4)); break;
+            case 0xcf: m_handler.int_value(static_cast<dynamic_t::int_t>(read_uint(8))); break;
+
+            case 0xd0: m_handler.int_value(static_cast<int8_t>(read_uint(1))); break;
+            case 0xd1: m_handler.int_value(static_cast<int16_t>(read_uint(2))); break;
+            case 0xd2: m_handler.int_value(static_cast<int32_t>(read_uint(4))); break;
+            case 0xd3: m_handler.int_value(static_cast<int64_t>(read_uint(8))); break;
+
+            case 0xc4: case 0xd9: string_value(read_uint(1)); break;
+            case 0xc5: case 0xda: string_value(read_uint(2)); break;
+            case 0xc6: case 0xdb: string_value(read_uint(4)); break;
+
+            case 0xdc: begin_array(read_uint(2)); break;
+            case 0xdd: begin_array(read_uint(4)); break;
+            case 0xde: begin_map(read_uint(2)); break;
+            case 0xdf: begin_map(read_uint(4)); break;
+
+            default:
+                throw msgpack::unpack_error("parse error");
+        }
+    }
+
+    void
+    parse_key() {
+        const unsigned char tag = read(1)[0];
+        size_t size = 0;
+
+        if ((tag & 0xe0) == 0xa0) {
+            size = tag & 0x1f;
+        } else if (tag == 0xd9 || tag == 0xc4) {
+            size = read_uint(1);
+        } else if (tag == 0xda || tag == 0xc5) {
+            size = read_uint(2);
+        } else if (tag == 0xdb || tag == 0xc6) {
+            size = read_uint(4);
+        } else {
+            // NOTE: The keys should be strings.
+            throw msgpack::type_error();
+        }
+
+        m_handler.key(read(size), size);
+    }
+
+    void
+    string_value(size_t size) {
+        m_handler.string_value(read(size), size);
+    }
+
+    void
+    begin_array(size_t size) {
+        m_handler.begin_array(size);
+
+        frame_t frame = { false, size };
+        m_stack.push_back(frame);
+    }
+
+    void
+    begin_map(size_t size) {
+        m_handler.begin_object(size);
+
+        frame_t frame = { true, 2 * static_cast<uint64_t>(size) };
+        m_stack.push_back(frame);
+    }
+
+    const char*
+    read(size_t size) {
+        if (m_size - m_offset < size) {
+            throw msgpack::unpack_error("insufficient bytes");
+        }
+
+        const char *result = m_data + m_offset;
+        m_offset += size;
+        return result;
+    }
+
+    // Reads a big-endian unsigned integer.
+    uint64_t
+    read_uint(size_t size) {
+        const char *bytes = read(size);
+        uint64_t result = 0;
+
+        for (size_t i = 0; i < size; ++i) {
+            result = (result << 8) | static_cast<unsigned char>(bytes[i]);
+        }
+
+        return result;
+    }
+
+private:
+    Handler& m_handler;
+
+    const char *m_data;
+    size_t m_size;
+    size_t m_offset;
+
+    std::vector<frame_t> m_stack;
+};
+
+template<class Handler>
+inline
+size_t
+parse_msgpack(const char *data, size_t size, Handler& handler) {
+    return msgpack_parser_t<Handler>(handler).parse(data, size);
+}
+
+}} // namespace cocaine::io
+
+#endif // COCAINE_DYNAMIC_PACK_HPP
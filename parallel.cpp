@@ -0,0 +1,184 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+
+using namespace cocaine;
+
+namespace {
+
+// The pool the calling thread works for and the index of its deque.
+thread_local const thread_pool_t *current_pool = nullptr;
+thread_local size_t current_index = 0;
+
+} // namespace
+
+thread_pool_t::thread_pool_t(size_t threads) :
+    m_queued(0),
+    m_stopped(false)
+{
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i <= threads; ++i) {
+        m_queues.emplace_back(new queue_t());
+    }
+
+    for (size_t i = 0; i < threads; ++i) {
+        m_threads.emplace_back(&thread_pool_t::work, this, i);
+    }
+}
+
+thread_pool_t::~thread_pool_t() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+    }
+
+    m_wakeup.notify_all();
+
+    for (auto it = m_threads.begin(); it != m_threads.end(); ++it) {
+        it->join();
+    }
+}
+
+size_t
+thread_pool_t::size() const {
+    return m_threads.size();
+}
+
+void
+thread_pool_t::push(task_t task) {
+    queue_t& queue = *m_queues[current()];
+
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    // Under the lock, so workers checking for tasks before going to sleep can't miss the wakeup.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_queued;
+    }
+
+    m_wakeup.notify_one();
+}
+
+bool
+thread_pool_t::starving() const {
+    queue_t& queue = *m_queues[current()];
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    return queue.tasks.empty();
+}
+
+bool
+thread_pool_t::run_one() {
+    const size_t self = current();
+    task_t task;
+
+    // The newest own task first, its data is most likely still in the cache.
+    {
+        queue_t& queue = *m_queues[self];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+    }
+
+    // Then the oldest task of someone else, which is usually the biggest one.
+    for (size_t i = 1; !task && i < m_queues.size(); ++i) {
+        queue_t& queue = *m_queues[(self + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+
+    if (!task) {
+        return false;
+    }
+
+    --m_queued;
+    task();
+    return true;
+}
+
+size_t
+thread_pool_t::current() const {
+    return current_pool == this ? current_index : m_threads.size();
+}
+
+void
+thread_pool_t::work(size_t index) {
+    current_pool = this;
+    current_index = index;
+
+    while (!m_stopped) {
+        if (run_one()) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        m_wakeup.wait(lock, [this]() {
+            return m_stopped || m_queued > 0;
+        });
+    }
+}
+
+task_group_t::task_group_t(thread_pool_t& pool) :
+    m_pool(pool),
+    m_pending(0)
+{
+    // pass
+}
+
+void
+task_group_t::wait() {
+    // Queued tasks are run in the meantime. Once there are none left, the remaining tasks of the group are running
+    // on other threads, so there is nothing to help with until they finish.
+    while (m_pending > 0) {
+        if (m_pool.run_one()) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        m_done.wait(lock, [this]() {
+            return m_pending == 0;
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_error) {
+        std::exception_ptr error = m_error;
+        m_error = std::exception_ptr();
+        std::rethrow_exception(error);
+    }
+}
+
+void
+task_group_t::finish() {
+    // Under the lock, so wait() can't miss the wakeup or return before the notification is done.
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (--m_pending == 0) {
+        m_done.notify_all();
+    }
+}
+
+void
+task_group_t::fail(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_error) {
+        m_error = error;
+    }
+}
@@ -0,0 +1,432 @@
+#ifndef COCAINE_DYNAMIC_PARALLEL_HPP
+#define COCAINE_DYNAMIC_PARALLEL_HPP
+
+#include "dynamic.hpp"
+#include "path.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cocaine {
+
+// Pool of worker threads with a task deque per worker. Workers run their own tasks newest first
+// and steal the oldest tasks of others when they run out of work.
+class thread_pool_t {
+public:
+    typedef std::function<void()> task_t;
+
+public:
+    // Zero means the number of hardware threads.
+    explicit
+    thread_pool_t(size_t threads = 0);
+
+    ~thread_pool_t();
+
+    size_t
+    size() const;
+
+    // Queues the task on the deque of the calling worker. Threads outside of the pool share a separate deque.
+    void
+    push(task_t task);
+
+    // Whether the deque of the calling thread is empty, so idle workers would have nothing to steal from it.
+    bool
+    starving() const;
+
+    // Runs one queued task on the calling thread if there is any.
+    bool
+    run_one();
+
+private:
+    thread_pool_t(const thread_pool_t&);
+
+    thread_pool_t&
+    operator=(const thread_pool_t&);
+
+    struct queue_t {
+        std::mutex mutex;
+        std::deque<task_t> tasks;
+    };
+
+    // Index of the deque of the calling thread.
+    size_t
+    current() const;
+
+    void
+    work(size_t index);
+
+private:
+    // Deques of the workers followed by the one of outside threads.
+    std::vector<std::unique_ptr<queue_t>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::atomic<size_t> m_queued;
+    std::atomic<bool> m_stopped;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+};
+
+// Set of tasks which are waited for together. Waiting threads run queued tasks in the meantime,
+// so tasks may spawn and wait for other tasks. The first exception thrown by a task is rethrown by wait().
+class task_group_t {
+public:
+    explicit
+    task_group_t(thread_pool_t& pool);
+
+    template<class F>
+    void
+    spawn(F task) {
+        ++m_pending;
+
+        m_pool.push([this, task]() {
+            try {
+                task();
+            } catch (...) {
+                fail(std::current_exception());
+            }
+
+            finish();
+        });
+    }
+
+    bool
+    starving() const {
+        return m_pool.starving();
+    }
+
+    void
+    wait();
+
+private:
+    void
+    finish();
+
+    void
+    fail(std::exception_ptr error);
+
+private:
+    thread_pool_t& m_pool;
+    std::atomic<size_t> m_pending;
+
+    std::mutex m_mutex;
+    // Signalled when the last pending task finishes.
+    std::condition_variable m_done;
+    std::exception_ptr m_error;
+};
+
+namespace detail { namespace dynamic {
+
+    // Splits the children of large containers between tasks. A range of siblings is halved
+    // only while the calling worker has no queued tasks left for others to steal, and only while
+    // it has at least threshold elements, so small subtrees are always walked sequentially
+    // and the number of tasks stays proportional to the number of workers.
+    template<class Walker>
+    struct splitter_t {
+        template<class Input, class Output>
+        static
+        void
+        walk(Walker& walker, Input first, Input last, size_t size, Output output) {
+            while (size > 0) {
+                if (size >= walker.m_threshold && walker.m_group.starving()) {
+                    const size_t half = size / 2;
+
+                    const Input middle = std::next(first, size - half);
+                    const Output output_middle = std::next(output, size - half);
+                    Walker *self = &walker;
+
+                    walker.m_group.spawn([self, middle, last, half, output_middle]() {
+                        splitter_t::walk(*self, middle, last, half, output_middle);
+                    });
+
+                    last = middle;
+                    size -= half;
+                    continue;
+                }
+
+                walker.visit(first, output);
+                ++first;
+                ++output;
+                --size;
+            }
+        }
+    };
+
+    // Output iterator which discards everything, for walks which don't produce a tree.
+    struct no_output_t :
+        public std::iterator<std::input_iterator_tag, void, std::ptrdiff_t, void, void>
+    {
+        no_output_t&
+        operator++() {
+            return *this;
+        }
+    };
+
+    template<class F>
+    struct leaf_walker_t {
+        leaf_walker_t(task_group_t& group, F& f, size_t threshold) :
+            m_group(group),
+            m_f(f),
+            m_threshold(threshold)
+        {
+            // pass
+        }
+
+        void
+        visit(const cocaine::dynamic_t& node) {
+            if (node.is_array()) {
+                const cocaine::dynamic_t::array_t& array = node.as_array();
+                splitter_t<leaf_walker_t>::walk(*this, array.data(), array.data() + array.size(), array.size(), no_output_t());
+            } else if (node.is_object()) {
+                const cocaine::dynamic_t::object_t& object = node.as_object();
+                splitter_t<leaf_walker_t>::walk(*this, object.begin(), object.end(), object.size(), no_output_t());
+            } else {
+                m_f(node);
+            }
+        }
+
+        void
+        visit(const cocaine::dynamic_t *node, no_output_t) {
+            visit(*node);
+        }
+
+        void
+        visit(cocaine::dynamic_t::object_t::const_iterator member, no_output_t) {
+            visit(member->second);
+        }
+
+        task_group_t& m_group;
+        F& m_f;
+        const size_t m_threshold;
+    };
+
+    template<class F>
+    struct transform_walker_t {
+        transform_walker_t(task_group_t& group, F& f, size_t threshold) :
+            m_group(group),
+            m_f(f),
+            m_threshold(threshold)
+        {
+            // pass
+        }
+
+        // Containers of the result are laid out before their children are filled in,
+        // so tasks write into distinct preallocated nodes and the result doesn't depend on the split.
+        void
+        visit(const cocaine::dynamic_t& node, cocaine::dynamic_t& result) {
+            if (node.is_array()) {
+                const cocaine::dynamic_t::array_t& array = node.as_array();
+                cocaine::dynamic_t::array_t& output = (result = cocaine::dynamic_t::array_t(array.size())).as_array();
+
+                splitter_t<transform_walker_t>::walk(*this, array.data(), array.data() + array.size(), array.size(), output.data());
+            } else if (node.is_object()) {
+                const cocaine::dynamic_t::object_t& object = node.as_object();
+                cocaine::dynamic_t::object_t& output = (result = cocaine::dynamic_t::object_t()).as_object();
+
+                for (auto it = object.begin(); it != object.end(); ++it) {
+                    output.emplace_hint(output.end(), it->first, cocaine::dynamic_t());
+                }
+
+                splitter_t<transform_walker_t>::walk(*this, object.begin(), object.end(), object.size(), output.begin());
+            } else {
+                result = m_f(node);
+            }
+        }
+
+        void
+        visit(const cocaine::dynamic_t *node, cocaine::dynamic_t *result) {
+            visit(*node, *result);
+        }
+
+        void
+        visit(cocaine::dynamic_t::object_t::const_iterator member, cocaine::dynamic_t::object_t::iterator result) {
+            visit(member->second, result->second);
+        }
+
+        task_group_t& m_group;
+        F& m_f;
+        const size_t m_threshold;
+    };
+
+    template<class Predicate>
+    struct find_walker_t {
+        // Position of a node as ordinals of the children on the way to it, which compare in document order.
+        typedef std::vector<size_t> position_t;
+
+        find_walker_t(task_group_t& group, Predicate& predicate, size_t threshold) :
+            m_group(group),
+            m_predicate(predicate),
+            m_threshold(threshold),
+            m_found(false)
+        {
+            // pass
+        }
+
+        void
+        visit(const cocaine::dynamic_t& node, position_t& position) {
+            // Subtrees following the best match found so far can't contain an earlier one.
+            if (m_found && after_best(position)) {
+                return;
+            }
+
+            if (node.is_array()) {
+                const cocaine::dynamic_t::array_t& array = node.as_array();
+                splitter_t<find_walker_t>::walk(*this, array.data(), array.data() + array.size(), array.size(), cursor_t(position));
+            } else if (node.is_object()) {
+                const cocaine::dynamic_t::object_t& object = node.as_object();
+                splitter_t<find_walker_t>::walk(*this, object.begin(), object.end(), object.size(), cursor_t(position));
+            } else if (m_predicate(node)) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                if (!m_found || position < m_best) {
+                    m_best = position;
+                    m_found = true;
+                }
+            }
+        }
+
+        // Position of the next child to visit. Copies of the cursor taken for spawned tasks own their positions.
+        struct cursor_t :
+            public std::iterator<std::input_iterator_tag, void, std::ptrdiff_t, void, void>
+        {
+            explicit
+            cursor_t(const position_t& parent) :
+                position(parent)
+            {
+                position.push_back(0);
+            }
+
+            cursor_t&
+            operator++() {
+                ++position.back();
+                return *this;
+            }
+
+            position_t position;
+        };
+
+        void
+        visit(const cocaine::dynamic_t *node, cursor_t& cursor) {
+            visit(*node, cursor.position);
+        }
+
+        void
+        visit(cocaine::dynamic_t::object_t::const_iterator member, cursor_t& cursor) {
+            visit(member->second, cursor.position);
+        }
+
+        bool
+        after_best(const position_t& position) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return !std::equal(position.begin(), position.begin() + std::min(position.size(), m_best.size()), m_best.begin()) &&
+                   m_best < position;
+        }
+
+        task_group_t& m_group;
+        Predicate& m_predicate;
+        const size_t m_threshold;
+
+        std::atomic<bool> m_found;
+        std::mutex m_mutex;
+        position_t m_best;
+    };
+
+}} // namespace detail::dynamic
+
+// Ranges of siblings shorter than this are never split between tasks.
+const size_t parallel_threshold = 64;
+
+// Calls f for every scalar and string of the tree. Calls are spread over the pool and come in no particular
+// order, so f must be safe to call concurrently. Rethrows the first exception thrown by f.
+template<class F>
+void
+parallel_for_each_leaf(const dynamic_t& root, F f, thread_pool_t& pool, size_t threshold = parallel_threshold) {
+    task_group_t group(pool);
+    detail::dynamic::leaf_walker_t<F> walker(group, f, threshold);
+
+    try {
+        walker.visit(root);
+    } catch (...) {
+        group.wait();
+        throw;
+    }
+
+    group.wait();
+}
+
+// Returns a tree of the same shape with every leaf replaced by f(leaf). The result is the same
+// no matter how the work has been split, f must be safe to call concurrently.
+template<class F>
+dynamic_t
+parallel_transform(const dynamic_t& root, F f, thread_pool_t& pool, size_t threshold = parallel_threshold) {
+    dynamic_t result;
+
+    task_group_t group(pool);
+    detail::dynamic::transform_walker_t<F> walker(group, f, threshold);
+
+    try {
+        walker.visit(root, result);
+    } catch (...) {
+        group.wait();
+        throw;
+    }
+
+    group.wait();
+    return result;
+}
+
+// Finds the first leaf in document order for which the predicate holds, e.g. the first invalid value.
+// Subtrees after the best match found so far are skipped. Returns false if there is no such leaf.
+template<class Predicate>
+bool
+parallel_find_if(const dynamic_t& root,
+                 Predicate predicate,
+                 path_t& result,
+                 thread_pool_t& pool,
+                 size_t threshold = parallel_threshold)
+{
+    task_group_t group(pool);
+    detail::dynamic::find_walker_t<Predicate> walker(group, predicate, threshold);
+    std::vector<size_t> position;
+
+    try {
+        walker.visit(root, position);
+    } catch (...) {
+        group.wait();
+        throw;
+    }
+
+    group.wait();
+
+    if (!walker.m_found) {
+        return false;
+    }
+
+    result = path_t();
+    const dynamic_t *node = &root;
+
+    for (auto it = walker.m_best.begin(); it != walker.m_best.end(); ++it) {
+        if (node->is_array()) {
+            result.append(*it);
+            node = &node->as_array()[*it];
+        } else {
+            auto member = std::next(node->as_object().begin(), *it);
+            result.append(member->first);
+            node = &member->second;
+        }
+    }
+
+    return true;
+}
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_PARALLEL_HPP
@@ -0,0 +1,317 @@
+#include "patch.hpp"
+#include "path.hpp"
+
+#include <algorithm>
+
+using namespace cocaine;
+
+namespace {
+
+class differ_t {
+public:
+    differ_t(dynamic_t::array_t& operations) :
+        m_operations(operations)
+    {
+        // pass
+    }
+
+    void
+    diff(const dynamic_t& from, const dynamic_t& to) {
+        if (from.is_object() && to.is_object()) {
+            diff(from.as_object(), to.as_object());
+        } else if (from.is_array() && to.is_array()) {
+            diff(from.as_array(), to.as_array());
+        } else if (from != to) {
+            emit("replace", &to);
+        }
+    }
+
+private:
+    void
+    diff(const dynamic_t::object_t& from, const dynamic_t::object_t& to) {
+        // Subtrees shared through deduplication are the same object.
+        if (&from == &to) {
+            return;
+        }
+
+        auto f = from.begin();
+        auto t = to.begin();
+
+        // Both objects are sorted by key, so a single merge pass finds all added, removed and common keys.
+        while (f != from.end() || t != to.end()) {
+            if (t == to.end() || (f != from.end() && f->first < t->first)) {
+                m_path.append(f->first);
+                emit("remove", nullptr);
+                ++f;
+            } else if (f == from.end() || t->first < f->first) {
+                m_path.append(t->first);
+                emit("add", &t->second);
+                ++t;
+            } else {
+                m_path.append(f->first);
+                diff(f->second, t->second);
+                ++f;
+                ++t;
+            }
+
+            m_path.pop_back();
+        }
+    }
+
+    void
+    diff(const dynamic_t::array_t& from, const dynamic_t::array_t& to) {
+        if (&from == &to) {
+            return;
+        }
+
+        size_t prefix = 0;
+
+        while (prefix < from.size() && prefix < to.size() && from[prefix] == to[prefix]) {
+            ++prefix;
+        }
+
+        size_t suffix = 0;
+
+        while (suffix < from.size() - prefix &&
+               suffix < to.size() - prefix &&
+               from[from.size() - suffix - 1] == to[to.size() - suffix - 1])
+        {
+            ++suffix;
+        }
+
+        const size_t from_size = from.size() - prefix - suffix;
+        const size_t to_size = to.size() - prefix - suffix;
+        const size_t common = std::min(from_size, to_size);
+
+        for (size_t i = 0; i < common; ++i) {
+            m_path.append(prefix + i);
+            diff(from[prefix + i], to[prefix + i]);
+            m_path.pop_back();
+        }
+
+        // Removing from the back keeps the indices of the remaining elements valid.
+        for (size_t i = from_size; i > common; --i) {
+            m_path.append(prefix + i - 1);
+            emit("remove", nullptr);
+            m_path.pop_back();
+        }
+
+        for (size_t i = common; i < to_size; ++i) {
+            m_path.append(prefix + i);
+            emit("add", &to[prefix + i]);
+            m_path.pop_back();
+        }
+    }
+
+    void
+    emit(const char *op, const dynamic_t *value) {
+        m_operations.emplace_back(dynamic_t::object_t());
+        dynamic_t::object_t& operation = m_operations.back().as_object();
+
+        operation["op"] = std::string(op);
+        operation["path"] = m_path.to_string();
+
+        if (value) {
+            operation["value"] = *value;
+        }
+    }
+
+private:
+    dynamic_t::array_t& m_operations;
+    path_t m_path;
+};
+
+const std::string&
+string_member(const dynamic_t::object_t& operation, const std::string& name) {
+    auto it = operation.find(name);
+
+    if (it == operation.end() || !it->second.is_string()) {
+        throw patch_error("operation must have a string '" + name + "' member");
+    }
+
+    return it->second.as_string();
+}
+
+path_t
+path_member(const dynamic_t::object_t& operation, const std::string& name) {
+    try {
+        return path_t(string_member(operation, name));
+    } catch (const path_error& e) {
+        throw patch_error(e.what());
+    }
+}
+
+// Works for both constant and mutable targets, the mutable lookup detaches shared subtrees on the way.
+template<class Target>
+Target&
+existing(Target& target, const path_t& path) {
+    Target *node = path.get(target);
+
+    if (!node) {
+        throw patch_error("path " + path.to_string() + " doesn't exist");
+    }
+
+    return *node;
+}
+
+void
+add(dynamic_t& target, const path_t& path, dynamic_t&& value) {
+    if (path.empty()) {
+        target = std::move(value);
+        return;
+    }
+
+    dynamic_t& parent = existing(target, path.parent());
+    const path_t::segment_t& segment = path.back();
+
+    if (parent.is_object()) {
+        parent.as_object()[segment.key] = std::move(value);
+    } else if (parent.is_array()) {
+        dynamic_t::array_t& array = parent.as_array();
+
+        if (segment.is_end) {
+            array.push_back(std::move(value));
+        } else if (segment.is_index && segment.index <= array.size()) {
+            array.insert(array.begin() + segment.index, std::move(value));
+        } else {
+            throw patch_error("invalid array index in path " + path.to_string());
+        }
+    } else {
+        throw patch_error("parent of path " + path.to_string() + " is not a container");
+    }
+}
+
+// The value is either copied or moved out of the patch by the caller.
+void
+apply_operation(dynamic_t& target, const dynamic_t::object_t& operation, dynamic_t&& value) {
+    const std::string& op = string_member(operation, "op");
+    const path_t path = path_member(operation, "path");
+
+    if ((op == "add" || op == "replace" || op == "test") && !operation.count("value")) {
+        throw patch_error("'" + op + "' operation must have a 'value' member");
+    }
+
+    if (op == "add") {
+        add(target, path, std::move(value));
+    } else if (op == "remove") {
+        if (!path.erase(target)) {
+            throw patch_error("path " + path.to_string() + " doesn't exist");
+        }
+    } else if (op == "replace") {
+        existing(target, path) = std::move(value);
+    } else if (op == "move" || op == "copy") {
+        const path_t from = path_member(operation, "from");
+
+        if (op == "copy") {
+            add(target, path, dynamic_t(existing(static_cast<const dynamic_t&>(target), from)));
+            return;
+        }
+
+        dynamic_t& source = existing(target, from);
+
+        if (from.size() < path.size() && std::equal(from.begin(), from.end(), path.begin(),
+            [](const path_t::segment_t& lhs, const path_t::segment_t& rhs) { return lhs.key == rhs.key; }))
+        {
+            throw patch_error("can't move " + from.to_string() + " into its own child");
+        }
+
+        dynamic_t moved = std::move(source);
+        from.erase(target);
+
+        // Removing the source shifts array elements, so the destination can only be checked afterwards.
+        // add() throws before taking the value, which is put back where it was then.
+        try {
+            add(target, path, std::move(moved));
+        } catch (...) {
+            add(target, from, std::move(moved));
+            throw;
+        }
+    } else if (op == "test") {
+        const dynamic_t *node = path.get(static_cast<const dynamic_t&>(target));
+
+        if (!node || *node != value) {
+            throw patch_error("test of path " + path.to_string() + " failed");
+        }
+    } else {
+        throw patch_error("unknown operation '" + op + "'");
+    }
+}
+
+} // namespace
+
+dynamic_t
+cocaine::diff(const dynamic_t& from, const dynamic_t& to) {
+    dynamic_t result = dynamic_t::array_t();
+    differ_t(result.as_array()).diff(from, to);
+    return result;
+}
+
+void
+cocaine::apply_patch(dynamic_t& target, const dynamic_t& patch) {
+    const dynamic_t::array_t& operations = patch.as_array();
+
+    for (auto it = operations.begin(); it != operations.end(); ++it) {
+        const dynamic_t::object_t& operation = it->as_object();
+        auto value = operation.find("value");
+
+        apply_operation(target, operation, value != operation.end() ? dynamic_t(value->second) : dynamic_t());
+    }
+}
+
+void
+cocaine::apply_patch(dynamic_t& target, dynamic_t&& patch) {
+    dynamic_t::array_t& operations = patch.as_array();
+
+    for (auto it = operations.begin(); it != operations.end(); ++it) {
+        dynamic_t::object_t& operation = it->as_object();
+        auto value = operation.find("value");
+
+        apply_operation(target, operation, value != operation.end() ? std::move(value->second) : dynamic_t());
+    }
+}
+
+void
+cocaine::apply_merge_patch(dynamic_t& target, const dynamic_t& patch) {
+    if (!patch.is_object()) {
+        target = patch;
+        return;
+    }
+
+    if (!target.is_object()) {
+        target = dynamic_t::object_t();
+    }
+
+    dynamic_t::object_t& object = target.as_object();
+    const dynamic_t::object_t& members = patch.as_object();
+
+    for (auto it = members.begin(); it != members.end(); ++it) {
+        if (it->second.is_null()) {
+            object.erase(it->first);
+        } else {
+            apply_merge_patch(object[it->first], it->second);
+        }
+    }
+}
+
+void
+cocaine::apply_merge_patch(dynamic_t& target, dynamic_t&& patch) {
+    if (!patch.is_object()) {
+        target = std::move(patch);
+        return;
+    }
+
+    if (!target.is_object()) {
+        target = dynamic_t::object_t();
+    }
+
+    dynamic_t::object_t& object = target.as_object();
+    dynamic_t::object_t& members = patch.as_object();
+
+    for (auto it = members.begin(); it != members.end(); ++it) {
+        if (it->second.is_null()) {
+            object.erase(it->first);
+        } else {
+            apply_merge_patch(object[it->first], std::move(it->second));
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef COCAINE_DYNAMIC_PATCH_HPP
+#define COCAINE_DYNAMIC_PATCH_HPP
+
+#include "dynamic.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace cocaine {
+
+struct patch_error :
+    public std::runtime_error
+{
+    patch_error(const std::string& message) :
+        std::runtime_error(message)
+    {
+        // pass
+    }
+};
+
+// Returns a JSON Patch (RFC 6902) which turns the first document into the second one:
+// an array of {"op": ..., "path": ..., "value": ...} objects using "add", "remove" and "replace" operations.
+// Objects are diffed with a linear merge of their sorted keys, arrays by stripping the common prefix and suffix
+// and diffing the rest element-wise, so small edits of large documents produce small patches.
+dynamic_t
+diff(const dynamic_t& from, const dynamic_t& to);
+
+// Applies a JSON Patch in place. Supports "add", "remove", "replace", "move", "copy" and "test" operations.
+// Throws patch_error if an operation is malformed or can't be applied, in which case the operations
+// before it remain applied.
+void
+apply_patch(dynamic_t& target, const dynamic_t& patch);
+
+// Same, but moves values out of the patch instead of copying them.
+void
+apply_patch(dynamic_t& target, dynamic_t&& patch);
+
+// Applies a JSON Merge Patch (RFC 7396): members of patch objects are merged recursively,
+// null members remove the corresponding keys, everything else replaces the target.
+void
+apply_merge_patch(dynamic_t& target, const dynamic_t& patch);
+
+void
+apply_merge_patch(dynamic_t& target, dynamic_t&& patch);
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_PATCH_HPP
@@ -0,0 +1,282 @@
+#include "path.hpp"
+
+using namespace cocaine;
+
+namespace {
+
+const dynamic_t*
+find_child(const dynamic_t& node, const path_t::segment_t& segment) {
+    if (node.is_object()) {
+        const dynamic_t::object_t& object = node.as_object();
+        auto it = object.find(segment.key);
+        return it == object.end() ? nullptr : &it->second;
+    } else if (node.is_array() && segment.is_index) {
+        const dynamic_t::array_t& array = node.as_array();
+        return segment.index < array.size() ? &array[segment.index] : nullptr;
+    } else {
+        return nullptr;
+    }
+}
+
+// Mutable access detaches every shared node on the way, so changes don't leak into the other copies of a subtree.
+dynamic_t*
+find_child(dynamic_t& node, const path_t::segment_t& segment) {
+    if (node.is_object()) {
+        dynamic_t::object_t& object = node.as_object();
+        auto it = object.find(segment.key);
+        return it == object.end() ? nullptr : &it->second;
+    } else if (node.is_array() && segment.is_index) {
+        dynamic_t::array_t& array = node.as_array();
+        return segment.index < array.size() ? &array[segment.index] : nullptr;
+    } else {
+        return nullptr;
+    }
+}
+
+} // namespace
+
+path_t::path_t() {
+    // pass
+}
+
+path_t::path_t(const std::string& pointer) {
+    if (pointer.empty()) {
+        return;
+    }
+
+    if (pointer[0] != '/') {
+        throw path_error("path must start with '/'");
+    }
+
+    std::string key;
+
+    for (size_t i = 1; i <= pointer.size(); ++i) {
+        if (i == pointer.size() || pointer[i] == '/') {
+            m_segments.push_back(make_segment(key));
+            key.clear();
+        } else if (pointer[i] == '~') {
+            if (i + 1 < pointer.size() && pointer[i + 1] == '0') {
+                key.push_back('~');
+            } else if (i + 1 < pointer.size() && pointer[i + 1] == '1') {
+                key.push_back('/');
+            } else {
+                throw path_error("invalid escape sequence in path");
+            }
+
+            ++i;
+        } else {
+            key.push_back(pointer[i]);
+        }
+    }
+}
+
+path_t&
+path_t::append(const std::string& key) {
+    m_segments.push_back(make_segment(key));
+    return *this;
+}
+
+path_t&
+path_t::append(size_t index) {
+    m_segments.push_back(make_segment(std::to_string(index)));
+    return *this;
+}
+
+void
+path_t::pop_back() {
+    m_segments.pop_back();
+}
+
+const dynamic_t*
+path_t::get(const dynamic_t& root) const {
+    const dynamic_t *node = &root;
+
+    for (auto it = m_segments.begin(); it != m_segments.end() && node; ++it) {
+        node = find_child(*node, *it);
+    }
+
+    return node;
+}
+
+dynamic_t*
+path_t::get(dynamic_t& root) const {
+    dynamic_t *node = &root;
+
+    for (auto it = m_segments.begin(); it != m_segments.end() && node; ++it) {
+        node = find_child(*node, *it);
+    }
+
+    return node;
+}
+
+const dynamic_t&
+path_t::get_or(const dynamic_t& root, const dynamic_t& def) const {
+    const dynamic_t *node = get(root);
+    return node ? *node : def;
+}
+
+dynamic_t&
+path_t::ensure(dynamic_t& root) const {
+    dynamic_t *node = &root;
+
+    for (auto it = m_segments.begin(); it != m_segments.end(); ++it) {
+        if (node->is_null() && (it->is_index || it->is_end)) {
+            node->as_array();
+        }
+
+        if (node->is_array()) {
+            dynamic_t::array_t& array = node->as_array();
+
+            if (it->is_end) {
+                array.emplace_back();
+                node = &array.back();
+            } else if (it->is_index) {
+                // As in JSON Patch, an index may only point at an element or right past the last one.
+                if (it->index == array.size()) {
+                    array.emplace_back();
+                } else if (it->index > array.size()) {
+                    throw path_error("array index is out of range");
+                }
+
+                node = &array[it->index];
+            } else {
+                throw boost::bad_get();
+            }
+        } else {
+            // Throws boost::bad_get for scalars.
+            node = &node->as_object()[it->key];
+        }
+    }
+
+    return *node;
+}
+
+bool
+path_t::erase(dynamic_t& root) const {
+    if (m_segments.empty()) {
+        return false;
+    }
+
+    dynamic_t *parent = this->parent().get(root);
+
+    if (!parent) {
+        return false;
+    }
+
+    const segment_t& segment = m_segments.back();
+
+    if (parent->is_object()) {
+        return parent->as_object().erase(segment.key) > 0;
+    } else if (parent->is_array() && segment.is_index) {
+        dynamic_t::array_t& array = parent->as_array();
+
+        if (segment.index < array.size()) {
+            array.erase(array.begin() + segment.index);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool
+path_t::empty() const {
+    return m_segments.empty();
+}
+
+size_t
+path_t::size() const {
+    return m_segments.size();
+}
+
+path_t::const_iterator
+path_t::begin() const {
+    return m_segments.begin();
+}
+
+path_t::const_iterator
+path_t::end() const {
+    return m_segments.end();
+}
+
+const path_t::segment_t&
+path_t::back() const {
+    return m_segments.back();
+}
+
+path_t
+path_t::parent() const {
+    path_t result(*this);
+
+    if (!result.m_segments.empty()) {
+        result.m_segments.pop_back();
+    }
+
+    return result;
+}
+
+std::string
+path_t::to_string() const {
+    std::string result;
+
+    for (auto it = m_segments.begin(); it != m_segments.end(); ++it) {
+        result.push_back('/');
+
+        for (auto c = it->key.begin(); c != it->key.end(); ++c) {
+            if (*c == '~') {
+                result.append("~0");
+            } else if (*c == '/') {
+                result.append("~1");
+            } else {
+                result.push_back(*c);
+            }
+        }
+    }
+
+    return result;
+}
+
+bool
+path_t::operator==(const path_t& other) const {
+    if (m_segments.size() != other.m_segments.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < m_segments.size(); ++i) {
+        if (m_segments[i].key != other.m_segments[i].key) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+path_t::operator!=(const path_t& other) const {
+    return !(*this == other);
+}
+
+path_t::segment_t
+path_t::make_segment(const std::string& key) {
+    segment_t segment;
+    segment.key = key;
+    segment.index = 0;
+    segment.is_index = false;
+    segment.is_end = (key == "-");
+
+    // Indices have no leading zeros and must fit into size_t.
+    if (!key.empty() && key.size() < 20 && (key.size() == 1 || key[0] != '0')) {
+        segment.is_index = true;
+
+        for (auto it = key.begin(); it != key.end(); ++it) {
+            if (*it < '0' || *it > '9') {
+                segment.is_index = false;
+                break;
+            }
+
+            segment.index = segment.index * 10 + (*it - '0');
+        }
+    }
+
+    return segment;
+}
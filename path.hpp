@@ -0,0 +1,124 @@
+#ifndef COCAINE_DYNAMIC_PATH_HPP
+#define COCAINE_DYNAMIC_PATH_HPP
+
+#include "dynamic.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cocaine {
+
+struct path_error :
+    public std::runtime_error
+{
+    path_error(const std::string& message) :
+        std::runtime_error(message)
+    {
+        // pass
+    }
+};
+
+// Precompiled JSON Pointer (RFC 6901), e.g. "/a/b/0/c".
+// The pointer is parsed once: keys are unescaped and numeric segments are converted into indices,
+// so lookups neither build strings nor throw on missing nodes.
+class path_t {
+public:
+    struct segment_t {
+        std::string key;
+
+        // Valid only if is_index is set. The "-" segment refers to the end of an array.
+        size_t index;
+        bool is_index;
+        bool is_end;
+    };
+
+    typedef std::vector<segment_t>::const_iterator const_iterator;
+
+public:
+    // The root path.
+    path_t();
+
+    // Throws path_error if the pointer is malformed.
+    explicit
+    path_t(const std::string& pointer);
+
+    path_t&
+    append(const std::string& key);
+
+    path_t&
+    append(size_t index);
+
+    // Removes the last segment.
+    void
+    pop_back();
+
+    // Returns nullptr if there is no such node.
+    const dynamic_t*
+    get(const dynamic_t& root) const;
+
+    // Shared subtrees on the way (see dedup.hpp) are detached, so the node may be changed through the pointer.
+    dynamic_t*
+    get(dynamic_t& root) const;
+
+    const dynamic_t&
+    get_or(const dynamic_t& root, const dynamic_t& def) const;
+
+    // Returns the node creating it and all missing intermediate nodes as nulls.
+    // Null intermediate nodes become arrays if the next segment is an index and objects otherwise.
+    // An index equal to the size of the array appends to it just like "-", larger ones throw path_error.
+    // Throws boost::bad_get if a node on the way is a scalar.
+    dynamic_t&
+    ensure(dynamic_t& root) const;
+
+    template<class T>
+    dynamic_t&
+    set(dynamic_t& root, T&& value) const {
+        return ensure(root) = std::forward<T>(value);
+    }
+
+    // Removes the node from its parent. Returns false if there is no such node.
+    bool
+    erase(dynamic_t& root) const;
+
+    bool
+    empty() const;
+
+    size_t
+    size() const;
+
+    const_iterator
+    begin() const;
+
+    const_iterator
+    end() const;
+
+    const segment_t&
+    back() const;
+
+    // Path without the last segment.
+    path_t
+    parent() const;
+
+    // Escaped pointer representation.
+    std::string
+    to_string() const;
+
+    bool
+    operator==(const path_t& other) const;
+
+    bool
+    operator!=(const path_t& other) const;
+
+private:
+    static
+    segment_t
+    make_segment(const std::string& key);
+
+private:
+    std::vector<segment_t> m_segments;
+};
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_PATH_HPP
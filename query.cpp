@@ -0,0 +1,502 @@
+#include "query.hpp"
+
+#include <cctype>
+#include <cstdlib>
+
+using namespace cocaine;
+
+namespace {
+
+bool
+is_identifier_start(char c) {
+    return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool
+is_identifier(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-';
+}
+
+void
+skip_spaces(const std::string& text, size_t& offset) {
+    while (offset < text.size() && std::isspace(static_cast<unsigned char>(text[offset]))) {
+        ++offset;
+    }
+}
+
+std::string
+parse_identifier(const std::string& text, size_t& offset) {
+    if (offset >= text.size() || !is_identifier_start(text[offset])) {
+        throw query_error("key expected", offset);
+    }
+
+    const size_t start = offset;
+
+    while (offset < text.size() && is_identifier(text[offset])) {
+        ++offset;
+    }
+
+    return text.substr(start, offset - start);
+}
+
+// Keys separated with dots and indices in brackets: limits.memory, tags[0].
+path_t
+parse_path(const std::string& text, size_t& offset) {
+    path_t result;
+    result.append(parse_identifier(text, offset));
+
+    while (offset < text.size()) {
+        if (text[offset] == '.') {
+            ++offset;
+            result.append(parse_identifier(text, offset));
+        } else if (text[offset] == '[') {
+            const size_t start = ++offset;
+
+            while (offset < text.size() && std::isdigit(static_cast<unsigned char>(text[offset]))) {
+                ++offset;
+            }
+
+            if (offset == start || offset >= text.size() || text[offset] != ']') {
+                throw query_error("index expected", start);
+            }
+
+            result.append(std::strtoull(text.c_str() + start, nullptr, 10));
+            ++offset;
+        } else {
+            break;
+        }
+    }
+
+    return result;
+}
+
+enum value_class_t {
+    int_value,
+    double_value,
+    string_value,
+    other_value
+};
+
+// Classifies a value with a single dispatch over its type.
+struct classify_t {
+    value_class_t
+    operator()(const dynamic_t::int_t&) const {
+        return int_value;
+    }
+
+    value_class_t
+    operator()(const dynamic_t::double_t&) const {
+        return double_value;
+    }
+
+    value_class_t
+    operator()(const dynamic_t::string_t&) const {
+        return string_value;
+    }
+
+    template<class T>
+    value_class_t
+    operator()(const T&) const {
+        return other_value;
+    }
+};
+
+double
+number_value(const dynamic_t& value, value_class_t type) {
+    return type == int_value ? static_cast<double>(value.as_int()) : value.as_double();
+}
+
+// The operator is predicate_t::operator_t: ==, !=, <, <=, >, >= in this order.
+template<class T>
+bool
+compare_values(const T& lhs, const T& rhs, int op) {
+    switch (op) {
+    case 0:
+        return lhs == rhs;
+    case 1:
+        return !(lhs == rhs);
+    case 2:
+        return lhs < rhs;
+    case 3:
+        return !(rhs < lhs);
+    case 4:
+        return rhs < lhs;
+    default:
+        return !(lhs < rhs);
+    }
+}
+
+} // namespace
+
+class predicate_t::parser_t {
+public:
+    parser_t(const std::string& text, std::vector<node_t>& nodes) :
+        m_text(text),
+        m_nodes(nodes),
+        m_offset(0)
+    {
+        // pass
+    }
+
+    size_t
+    parse() {
+        const size_t root = parse_or();
+
+        skip_spaces(m_text, m_offset);
+
+        if (m_offset != m_text.size()) {
+            throw query_error("unexpected character", m_offset);
+        }
+
+        return root;
+    }
+
+private:
+    size_t
+    parse_or() {
+        size_t result = parse_and();
+
+        while (consume("||")) {
+            result = binary(or_node, result, parse_and());
+        }
+
+        return result;
+    }
+
+    size_t
+    parse_and() {
+        size_t result = parse_unary();
+
+        while (consume("&&")) {
+            result = binary(and_node, result, parse_unary());
+        }
+
+        return result;
+    }
+
+    size_t
+    parse_unary() {
+        if (consume("!")) {
+            node_t node = make_node(not_node);
+            node.lhs = parse_unary();
+            return push(node);
+        }
+
+        if (consume("(")) {
+            const size_t result = parse_or();
+
+            if (!consume(")")) {
+                throw query_error("')' expected", m_offset);
+            }
+
+            return result;
+        }
+
+        return parse_comparison();
+    }
+
+    size_t
+    parse_comparison() {
+        node_t node = make_node(test_node);
+        node.left = parse_operand();
+
+        static const char *const operators[] = { "==", "!=", "<=", ">=", "<", ">" };
+        static const operator_t codes[] = { equal, not_equal, less_equal, greater_equal, less, greater };
+
+        for (size_t i = 0; i < sizeof(codes) / sizeof(codes[0]); ++i) {
+            if (consume(operators[i])) {
+                node.kind = compare_node;
+                node.op = codes[i];
+                node.right = parse_operand();
+                return push(node);
+            }
+        }
+
+        if (!node.left.is_path) {
+            throw query_error("comparison expected", m_offset);
+        }
+
+        return push(node);
+    }
+
+    operand_t
+    parse_operand() {
+        skip_spaces(m_text, m_offset);
+
+        operand_t result;
+        result.is_path = false;
+
+        if (m_offset >= m_text.size()) {
+            throw query_error("operand expected", m_offset);
+        }
+
+        const char c = m_text[m_offset];
+
+        if (c == '"') {
+            std::string value;
+
+            for (++m_offset; m_offset < m_text.size() && m_text[m_offset] != '"'; ++m_offset) {
+                if (m_text[m_offset] == '\\' && m_offset + 1 < m_text.size()) {
+                    ++m_offset;
+                }
+
+                value.push_back(m_text[m_offset]);
+            }
+
+            if (m_offset >= m_text.size()) {
+                throw query_error("unterminated string", m_offset);
+            }
+
+            ++m_offset;
+            result.literal = value;
+        } else if (std::isdigit(static_cast<unsigned char>(c)) || c == '-') {
+            const char *start = m_text.c_str() + m_offset;
+            char *end = nullptr;
+
+            const long long integer = std::strtoll(start, &end, 10);
+
+            if (*end == '.' || *end == 'e' || *end == 'E') {
+                result.literal = std::strtod(start, &end);
+            } else {
+                result.literal = static_cast<dynamic_t::int_t>(integer);
+            }
+
+            if (end == start) {
+                throw query_error("number expected", m_offset);
+            }
+
+            m_offset += end - start;
+        } else if (keyword("true")) {
+            result.literal = true;
+        } else if (keyword("false")) {
+            result.literal = false;
+        } else if (keyword("null")) {
+            result.literal = dynamic_t::null_t();
+        } else {
+            result.is_path = true;
+            result.path = parse_path(m_text, m_offset);
+        }
+
+        return result;
+    }
+
+    bool
+    keyword(const char *word) {
+        const size_t size = std::char_traits<char>::length(word);
+
+        if (m_text.compare(m_offset, size, word) != 0 ||
+            (m_offset + size < m_text.size() && is_identifier(m_text[m_offset + size])))
+        {
+            return false;
+        }
+
+        m_offset += size;
+        return true;
+    }
+
+    bool
+    consume(const char *token) {
+        skip_spaces(m_text, m_offset);
+
+        const size_t size = std::char_traits<char>::length(token);
+
+        if (m_text.compare(m_offset, size, token) != 0) {
+            return false;
+        }
+
+        // "!" must not swallow the beginning of "!=".
+        if (size == 1 && token[0] == '!' && m_offset + 1 < m_text.size() && m_text[m_offset + 1] == '=') {
+            return false;
+        }
+
+        m_offset += size;
+        return true;
+    }
+
+    node_t
+    make_node(kind_t kind) {
+        node_t node;
+        node.kind = kind;
+        node.op = equal;
+        node.lhs = node.rhs = 0;
+        node.left.is_path = node.right.is_path = false;
+        return node;
+    }
+
+    size_t
+    binary(kind_t kind, size_t lhs, size_t rhs) {
+        node_t node = make_node(kind);
+        node.lhs = lhs;
+        node.rhs = rhs;
+        return push(node);
+    }
+
+    size_t
+    push(const node_t& node) {
+        m_nodes.push_back(node);
+        return m_nodes.size() - 1;
+    }
+
+private:
+    const std::string& m_text;
+    std::vector<node_t>& m_nodes;
+    size_t m_offset;
+};
+
+predicate_t::predicate_t(const std::string& expression) {
+    m_root = parser_t(expression, m_nodes).parse();
+}
+
+bool
+predicate_t::operator()(const dynamic_t& record) const {
+    // Records are usually objects, so the object is looked up once for all the paths.
+    return evaluate(m_root, record.is_object() ? &record.as_object() : nullptr);
+}
+
+bool
+predicate_t::evaluate(size_t index, const dynamic_t::object_t *record) const {
+    const node_t& node = m_nodes[index];
+
+    switch (node.kind) {
+    case or_node:
+        return evaluate(node.lhs, record) || evaluate(node.rhs, record);
+
+    case and_node:
+        return evaluate(node.lhs, record) && evaluate(node.rhs, record);
+
+    case not_node:
+        return !evaluate(node.lhs, record);
+
+    case test_node: {
+        const dynamic_t *value = resolve(node.left, record);
+        return value && !value->is_null() && !(value->is_bool() && !value->as_bool());
+    }
+
+    default:
+        return compare(resolve(node.left, record), resolve(node.right, record), node.op);
+    }
+}
+
+const dynamic_t*
+predicate_t::resolve(const operand_t& operand, const dynamic_t::object_t *record) {
+    if (!operand.is_path) {
+        return &operand.literal;
+    }
+
+    if (!record) {
+        return nullptr;
+    }
+
+    // Paths always start with a key.
+    auto segment = operand.path.begin();
+    auto member = record->find(segment->key);
+
+    if (member == record->end()) {
+        return nullptr;
+    }
+
+    const dynamic_t *node = &member->second;
+
+    for (++segment; segment != operand.path.end() && node; ++segment) {
+        if (node->is_object()) {
+            member = node->as_object().find(segment->key);
+            node = member == node->as_object().end() ? nullptr : &member->second;
+        } else if (node->is_array() && segment->is_index && segment->index < node->as_array().size()) {
+            node = &node->as_array()[segment->index];
+        } else {
+            node = nullptr;
+        }
+    }
+
+    return node;
+}
+
+bool
+predicate_t::compare(const dynamic_t *lhs, const dynamic_t *rhs, operator_t op) {
+    if (!lhs || !rhs) {
+        return op == not_equal;
+    }
+
+    const value_class_t lhs_type = lhs->visit(classify_t());
+    const value_class_t rhs_type = rhs->visit(classify_t());
+
+    if (lhs_type == string_value && rhs_type == string_value) {
+        return compare_values(lhs->as_string(), rhs->as_string(), op);
+    } else if (lhs_type == int_value && rhs_type == int_value) {
+        return compare_values(lhs->as_int(), rhs->as_int(), op);
+    } else if (lhs_type <= double_value && rhs_type <= double_value) {
+        return compare_values(number_value(*lhs, lhs_type), number_value(*rhs, rhs_type), op);
+    } else if (op == equal) {
+        return *lhs == *rhs;
+    } else if (op == not_equal) {
+        return *lhs != *rhs;
+    } else {
+        return false;
+    }
+}
+
+projection_t::projection_t(const std::string& paths) {
+    size_t offset = 0;
+
+    while (true) {
+        skip_spaces(paths, offset);
+
+        const size_t start = offset;
+        const path_t path = parse_path(paths, offset);
+        m_fields.push_back(std::make_pair(paths.substr(start, offset - start), path));
+
+        skip_spaces(paths, offset);
+
+        if (offset == paths.size()) {
+            break;
+        }
+
+        if (paths[offset] != ',') {
+            throw query_error("',' expected", offset);
+        }
+
+        ++offset;
+    }
+}
+
+dynamic_t
+projection_t::operator()(const dynamic_t& record) const {
+    dynamic_t result = dynamic_t::object_t();
+    dynamic_t::object_t& object = result.as_object();
+
+    for (auto it = m_fields.begin(); it != m_fields.end(); ++it) {
+        const dynamic_t *value = it->second.get(record);
+        object[it->first] = value ? *value : dynamic_t();
+    }
+
+    return result;
+}
+
+void
+cocaine::filter(const dynamic_t::array_t& records, const predicate_t& predicate, std::vector<size_t>& result) {
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (predicate(records[i])) {
+            result.push_back(i);
+        }
+    }
+}
+
+std::vector<size_t>
+cocaine::filter(const dynamic_t::array_t& records, const predicate_t& predicate) {
+    std::vector<size_t> result;
+    filter(records, predicate, result);
+    return result;
+}
+
+dynamic_t::array_t
+cocaine::select(const dynamic_t::array_t& records, const predicate_t& predicate, const projection_t& projection) {
+    dynamic_t::array_t result;
+
+    for (auto it = records.begin(); it != records.end(); ++it) {
+        if (predicate(*it)) {
+            result.push_back(projection(*it));
+        }
+    }
+
+    return result;
+}
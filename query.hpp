@@ -0,0 +1,132 @@
+#ifndef COCAINE_DYNAMIC_QUERY_HPP
+#define COCAINE_DYNAMIC_QUERY_HPP
+
+#include "dynamic.hpp"
+#include "path.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cocaine {
+
+struct query_error :
+    public std::runtime_error
+{
+    query_error(const std::string& message, size_t offset) :
+        std::runtime_error(message + " at offset " + std::to_string(offset)),
+        m_offset(offset)
+    {
+        // pass
+    }
+
+    size_t
+    offset() const {
+        return m_offset;
+    }
+
+private:
+    size_t m_offset;
+};
+
+// Predicate over records compiled once from an expression like
+//     status == "active" && (weight > 3 || !disabled)
+// Operands are paths into the record made of keys and indices (limits.memory, tags[0]) and literals:
+// numbers, "strings" with \" and \\ escapes, true, false and null. Comparisons are ==, !=, <, <=, > and >=.
+// Ints and doubles compare by value, strings lexicographically, other values only for (in)equality.
+// A bare path holds if the value exists and is neither null nor false. Missing values fail all comparisons but !=.
+// Evaluation doesn't allocate.
+class predicate_t {
+public:
+    // Throws query_error if the expression is malformed.
+    explicit
+    predicate_t(const std::string& expression);
+
+    bool
+    operator()(const dynamic_t& record) const;
+
+private:
+    class parser_t;
+
+    enum kind_t {
+        or_node,
+        and_node,
+        not_node,
+        test_node,
+        compare_node
+    };
+
+    enum operator_t {
+        equal,
+        not_equal,
+        less,
+        less_equal,
+        greater,
+        greater_equal
+    };
+
+    struct operand_t {
+        bool is_path;
+        path_t path;
+        dynamic_t literal;
+    };
+
+    // Nodes refer to their children by indices in m_nodes.
+    struct node_t {
+        kind_t kind;
+        operator_t op;
+
+        size_t lhs;
+        size_t rhs;
+
+        operand_t left;
+        operand_t right;
+    };
+
+    // The record is null if it isn't an object.
+    bool
+    evaluate(size_t index, const dynamic_t::object_t *record) const;
+
+    static
+    const dynamic_t*
+    resolve(const operand_t& operand, const dynamic_t::object_t *record);
+
+    static
+    bool
+    compare(const dynamic_t *lhs, const dynamic_t *rhs, operator_t op);
+
+private:
+    std::vector<node_t> m_nodes;
+    size_t m_root;
+};
+
+// Projection compiled once from a comma-separated list of paths like "name, limits.memory, tags[0]".
+// Records are projected into objects keyed by the paths as written, missing values become nulls.
+class projection_t {
+public:
+    // Throws query_error if a path is malformed.
+    explicit
+    projection_t(const std::string& paths);
+
+    dynamic_t
+    operator()(const dynamic_t& record) const;
+
+private:
+    std::vector<std::pair<std::string, path_t>> m_fields;
+};
+
+// Appends the indices of the matching records to the result.
+void
+filter(const dynamic_t::array_t& records, const predicate_t& predicate, std::vector<size_t>& result);
+
+std::vector<size_t>
+filter(const dynamic_t::array_t& records, const predicate_t& predicate);
+
+// Projections of the matching records.
+dynamic_t::array_t
+select(const dynamic_t::array_t& records, const predicate_t& predicate, const projection_t& projection);
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_QUERY_HPP
@@ -0,0 +1,213 @@
+#ifndef COCAINE_DYNAMIC_READER_HPP
+#define COCAINE_DYNAMIC_READER_HPP
+
+#include "dynamic.hpp"
+#include "traits.hpp"
+
+#include <cstring>
+
+namespace cocaine { namespace io {
+
+// Pull reader over a msgpack stream which consists of a single top-level array or map.
+// Only the outer header is decoded eagerly, elements are unpacked one by one as soon as
+// their bytes arrive, so the whole batch is never materialized at once.
+class dynamic_reader_t {
+public:
+    enum container_type {
+        unknown,
+        array,
+        map
+    };
+
+    dynamic_reader_t() :
+        m_container(unknown),
+        m_size(0),
+        m_consumed(0),
+        m_has_key(false)
+    {
+        // pass
+    }
+
+    // Appends the next chunk of the stream. The data is copied, so the chunk may be reused right away.
+    void
+    feed(const char *data, size_t size) {
+        if (m_container == unknown) {
+            size_t used = read_header(data, size);
+            data += used;
+            size -= used;
+        }
+
+        if (size > 0) {
+            m_unpacker.reserve_buffer(size);
+            std::memcpy(m_unpacker.buffer(), data, size);
+            m_unpacker.buffer_consumed(size);
+        }
+    }
+
+    // Type of the outer container, unknown until its header has been fed.
+    container_type
+    container() const {
+        return m_container;
+    }
+
+    // Number of elements (key-value pairs for maps) declared in the outer header.
+    size_t
+    size() const {
+        return m_size;
+    }
+
+    size_t
+    remaining() const {
+        return m_size - m_consumed;
+    }
+
+    bool
+    done() const {
+        return m_container != unknown && m_consumed == m_size;
+    }
+
+    // Extracts the next array element without converting it into dynamic_t.
+    // Returns false if the header or the element hasn't arrived completely yet or the array is exhausted.
+    // Throws msgpack::type_error once the header turns out to be the one of a map.
+    bool
+    next(msgpack::unpacked& element) {
+        if (m_container == unknown) {
+            return false;
+        }
+
+        if (m_container != array) {
+            throw msgpack::type_error();
+        }
+
+        if (done() || !m_unpacker.next(&element)) {
+            return false;
+        }
+
+        ++m_consumed;
+        return true;
+    }
+
+    bool
+    next(dynamic_t& element) {
+        msgpack::unpacked result;
+
+        if (!next(result)) {
+            return false;
+        }
+
+        type_traits<dynamic_t>::unpack(result.get(), element);
+        return true;
+    }
+
+    // Extracts the next key-value pair of the outer map.
+    bool
+    next(std::string& key, dynamic_t& value) {
+        if (m_container == unknown) {
+            return false;
+        }
+
+        if (m_container != map) {
+            throw msgpack::type_error();
+        }
+
+        if (done()) {
+            return false;
+        }
+
+        if (!m_has_key) {
+            if (!m_unpacker.next(&m_key)) {
+                return false;
+            }
+
+            if (m_key.get().type != msgpack::type::RAW) {
+                // NOTE: The keys should be strings.
+                throw msgpack::type_error();
+            }
+
+            m_has_key = true;
+        }
+
+        msgpack::unpacked result;
+
+        if (!m_unpacker.next(&result)) {
+            return false;
+        }
+
+        key = m_key.get().as<std::string>();
+        type_traits<dynamic_t>::unpack(result.get(), value);
+
+        m_has_key = false;
+        ++m_consumed;
+        return true;
+    }
+
+private:
+    // Consumes bytes of the outer header and returns how many of them were used.
+    size_t
+    read_header(const char *data, size_t size) {
+        size_t used = 0;
+
+        if (m_header.empty() && size > 0) {
+            m_header.push_back(data[0]);
+            ++used;
+        }
+
+        if (m_header.empty()) {
+            return used;
+        }
+
+        const unsigned char tag = m_header[0];
+        size_t length = 0;
+        container_type container = unknown;
+
+        if ((tag & 0xf0) == 0x90) {
+            container = array;
+        } else if ((tag & 0xf0) == 0x80) {
+            container = map;
+        } else if (tag == 0xdc || tag == 0xde) {
+            length = 2;
+            container = (tag == 0xdc ? array : map);
+        } else if (tag == 0xdd || tag == 0xdf) {
+            length = 4;
+            container = (tag == 0xdd ? array : map);
+        } else {
+            // NOTE: The stream should start with an array or a map.
+            throw msgpack::type_error();
+        }
+
+        while (m_header.size() < length + 1 && used < size) {
+            m_header.push_back(data[used++]);
+        }
+
+        if (m_header.size() < length + 1) {
+            return used;
+        }
+
+        if (length == 0) {
+            m_size = tag & 0x0f;
+        } else {
+            for (size_t i = 1; i <= length; ++i) {
+                m_size = (m_size << 8) | static_cast<unsigned char>(m_header[i]);
+            }
+        }
+
+        m_container = container;
+        return used;
+    }
+
+private:
+    msgpack::unpacker m_unpacker;
+
+    std::string m_header;
+    container_type m_container;
+    size_t m_size;
+    size_t m_consumed;
+
+    // The key of a map entry whose value hasn't arrived yet.
+    msgpack::unpacked m_key;
+    bool m_has_key;
+};
+
+}} // namespace cocaine::io
+
+#endif // COCAINE_DYNAMIC_READER_HPP
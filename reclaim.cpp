@@ -0,0 +1,162 @@
+#include "reclaim.hpp"
+
+#include <algorithm>
+
+using namespace cocaine;
+
+namespace {
+
+// Counts the nodes of the tree until the budget runs out. Returns whether it has run out.
+bool
+exceeds(const dynamic_t& value, size_t& budget) {
+    if (budget == 0) {
+        return true;
+    }
+
+    --budget;
+
+    if (value.is_array()) {
+        const dynamic_t::array_t& array = value.as_array();
+
+        // Scalars are counted without visiting them.
+        if (array.size() >= budget) {
+            budget = 0;
+            return true;
+        }
+
+        for (auto it = array.begin(); it != array.end(); ++it) {
+            if (exceeds(*it, budget)) {
+                return true;
+            }
+        }
+    } else if (value.is_object()) {
+        const dynamic_t::object_t& object = value.as_object();
+
+        if (object.size() >= budget) {
+            budget = 0;
+            return true;
+        }
+
+        for (auto it = object.begin(); it != object.end(); ++it) {
+            if (exceeds(it->second, budget)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+} // namespace
+
+reclaimer_t::reclaimer_t(size_t threshold, size_t capacity) :
+    m_threshold(threshold),
+    m_capacity(capacity),
+    m_busy(false),
+    m_stopped(false),
+    m_small(0)
+{
+    m_stats.queued = 0;
+    m_stats.peak = 0;
+    m_stats.deferred = 0;
+    m_stats.small = 0;
+    m_stats.overflowed = 0;
+
+    m_thread = std::thread(&reclaimer_t::work, this);
+}
+
+reclaimer_t::~reclaimer_t() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+    }
+
+    m_wakeup.notify_one();
+    m_thread.join();
+}
+
+bool
+reclaimer_t::retire(dynamic_t& value) {
+    size_t budget = m_threshold;
+
+    if (!exceeds(value, budget)) {
+        value = dynamic_t();
+        ++m_small;
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_queue.size() >= m_capacity) {
+        ++m_stats.overflowed;
+        lock.unlock();
+
+        value = dynamic_t();
+        return false;
+    }
+
+    m_queue.push_back(std::move(value));
+    value = dynamic_t();
+
+    m_stats.peak = std::max(m_stats.peak, m_queue.size());
+    lock.unlock();
+
+    m_wakeup.notify_one();
+    return true;
+}
+
+bool
+reclaimer_t::retire(dynamic_t&& value) {
+    return retire(value);
+}
+
+void
+reclaimer_t::drain() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_drained.wait(lock, [this]() {
+        return m_queue.empty() && !m_busy;
+    });
+}
+
+reclaimer_t::stats_t
+reclaimer_t::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    stats_t result = m_stats;
+    result.queued = m_queue.size();
+    result.small = m_small;
+
+    return result;
+}
+
+void
+reclaimer_t::work() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_wakeup.wait(lock, [this]() {
+            return m_stopped || !m_queue.empty();
+        });
+
+        if (m_queue.empty()) {
+            // Stopped with nothing left to destroy.
+            break;
+        }
+
+        dynamic_t value(std::move(m_queue.front()));
+        m_queue.pop_front();
+        m_busy = true;
+
+        lock.unlock();
+        value = dynamic_t();
+        lock.lock();
+
+        m_busy = false;
+        ++m_stats.deferred;
+
+        if (m_queue.empty()) {
+            m_drained.notify_all();
+        }
+    }
+}
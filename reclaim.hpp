@@ -0,0 +1,94 @@
+#ifndef COCAINE_DYNAMIC_RECLAIM_HPP
+#define COCAINE_DYNAMIC_RECLAIM_HPP
+
+#include "dynamic.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace cocaine {
+
+// Trees with fewer nodes than this are destroyed right away, handing them over would cost more.
+const size_t reclaim_threshold = 4096;
+
+// Default bound of the queue of trees waiting for destruction.
+const size_t reclaim_capacity = 64;
+
+// Destroys large documents on a background thread, so the threads which drop them, e.g. at the end
+// of a request, don't spend their time in the recursive destructors:
+//
+//     reclaimer.retire(std::move(response));
+//
+// The size of a tree is only counted up to the threshold, so deciding takes at most threshold steps.
+// Trees below the threshold are destroyed by the calling thread. So are the trees which find the queue full,
+// which bounds the memory held by the queue. Thread-safe.
+class reclaimer_t {
+public:
+    struct stats_t {
+        // Trees waiting for destruction now and at most so far.
+        size_t queued;
+        size_t peak;
+
+        // Trees destroyed by the background thread, by the calling threads because they were small
+        // and because the queue was full.
+        size_t deferred;
+        size_t small;
+        size_t overflowed;
+    };
+
+public:
+    explicit
+    reclaimer_t(size_t threshold = reclaim_threshold, size_t capacity = reclaim_capacity);
+
+    // Destroys the trees still queued.
+    ~reclaimer_t();
+
+    // Takes the tree away, leaving null behind. Returns whether its destruction has been deferred.
+    bool
+    retire(dynamic_t& value);
+
+    bool
+    retire(dynamic_t&& value);
+
+    // Waits until all the trees queued so far are destroyed.
+    void
+    drain();
+
+    stats_t
+    stats() const;
+
+private:
+    reclaimer_t(const reclaimer_t&);
+
+    reclaimer_t&
+    operator=(const reclaimer_t&);
+
+    void
+    work();
+
+private:
+    const size_t m_threshold;
+    const size_t m_capacity;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_drained;
+
+    std::deque<dynamic_t> m_queue;
+    // Whether the background thread is destroying a tree taken from the queue.
+    bool m_busy;
+    bool m_stopped;
+
+    stats_t m_stats;
+    // Small trees are destroyed without taking the lock.
+    std::atomic<size_t> m_small;
+
+    std::thread m_thread;
+};
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_RECLAIM_HPP
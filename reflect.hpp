@@ -0,0 +1,231 @@
+#ifndef COCAINE_DYNAMIC_REFLECT_HPP
+#define COCAINE_DYNAMIC_REFLECT_HPP
+
+#include "dynamic.hpp"
+
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Declarative binding of struct members to object keys. At the global namespace scope:
+//
+//     struct endpoint_t { std::string host; int port; };
+//     COCAINE_DYNAMIC_REFLECT(endpoint_t, (host)(port))
+//
+// defines both the dynamic_constructor and the dynamic_converter for the struct, keys are the names of the members.
+// Members may be of any type dynamic_t converts to and from, including other reflected structs.
+// The struct must be default constructible: members missing from the object keep their default values,
+// unknown keys are ignored.
+//
+// Fields are sorted by key once, so conversion walks the sorted keys of object_t and the fields side by side
+// in a single merge instead of looking every field up in the map, and construction appends the members
+// to the object in order without searching for the insertion points.
+
+#define COCAINE_DYNAMIC_REFLECT_FIELD(r, type, member) \
+    cocaine::detail::dynamic::make_field<type, decltype(type::member), &type::member>(BOOST_PP_STRINGIZE(member)),
+
+#define COCAINE_DYNAMIC_REFLECT(type, members) \
+    namespace cocaine { \
+    template<> \
+    struct dynamic_reflection<type> { \
+        static const bool enable = true; \
+        static \
+        std::vector<detail::dynamic::field_t<type>> \
+        fields() { \
+            return { BOOST_PP_SEQ_FOR_EACH(COCAINE_DYNAMIC_REFLECT_FIELD, type, members) }; \
+        } \
+    }; \
+    }
+
+namespace cocaine {
+
+template<class T>
+struct dynamic_reflection {
+    static const bool enable = false;
+};
+
+namespace detail { namespace dynamic {
+
+    template<class T>
+    struct field_t {
+        std::string key;
+
+        void (*load)(T&, const cocaine::dynamic_t&);
+        bool (*try_load)(T&, const cocaine::dynamic_t&);
+        bool (*convertible)(const cocaine::dynamic_t&);
+        // Constructs the member value right in a new node appended to the object.
+        void (*append)(const T&, const std::string&, cocaine::dynamic_t::object_t&);
+    };
+
+    template<class T, class Member, Member T::*Pointer>
+    struct field_access {
+        static
+        void
+        load(T& object, const cocaine::dynamic_t& from) {
+            object.*Pointer = from.to<Member>();
+        }
+
+        static
+        bool
+        try_load(T& object, const cocaine::dynamic_t& from) {
+            auto value = from.try_to<Member>();
+
+            if (!value) {
+                return false;
+            }
+
+            object.*Pointer = std::move(*value);
+            return true;
+        }
+
+        static
+        bool
+        convertible(const cocaine::dynamic_t& from) {
+            return from.convertible_to<Member>();
+        }
+
+        static
+        void
+        append(const T& object, const std::string& key, cocaine::dynamic_t::object_t& to) {
+            to.emplace_hint(to.end(), key, object.*Pointer);
+        }
+    };
+
+    template<class T, class Member, Member T::*Pointer>
+    field_t<T>
+    make_field(const char *key) {
+        typedef field_access<T, Member, Pointer> access_type;
+
+        field_t<T> result = { key, &access_type::load, &access_type::try_load, &access_type::convertible, &access_type::append };
+        return result;
+    }
+
+    // Fields in the order of keys of object_t.
+    template<class T>
+    const std::vector<field_t<T>>&
+    sorted_fields() {
+        static const std::vector<field_t<T>> fields = [] {
+            std::vector<field_t<T>> result = dynamic_reflection<T>::fields();
+
+            std::sort(result.begin(), result.end(), [](const field_t<T>& lhs, const field_t<T>& rhs) {
+                return lhs.key < rhs.key;
+            });
+
+            return result;
+        }();
+
+        return fields;
+    }
+
+    // Calls the handler for every field present in the object until it returns false.
+    // Returns false if the handler has stopped the merge.
+    template<class T, class Handler>
+    bool
+    merge_fields(const cocaine::dynamic_t::object_t& object, Handler handler) {
+        const std::vector<field_t<T>>& fields = sorted_fields<T>();
+
+        auto member = object.begin();
+        auto field = fields.begin();
+
+        while (member != object.end() && field != fields.end()) {
+            const int order = member->first.compare(field->key);
+
+            if (order < 0) {
+                ++member;
+            } else if (order > 0) {
+                ++field;
+            } else {
+                if (!handler(*field, member->second)) {
+                    return false;
+                }
+
+                ++member;
+                ++field;
+            }
+        }
+
+        return true;
+    }
+
+}} // namespace detail::dynamic
+
+template<class From>
+struct dynamic_constructor<From, typename std::enable_if<dynamic_reflection<From>::enable>::type> {
+    static const bool enable = true;
+
+    static
+    inline
+    void
+    convert(const From& from, dynamic_t::value_t& to) {
+        const std::vector<detail::dynamic::field_t<From>>& fields = detail::dynamic::sorted_fields<From>();
+
+        to = dynamic_t::object_t();
+        dynamic_t::object_t& object = boost::get<dynamic_t::object_t>(to);
+
+        for (auto it = fields.begin(); it != fields.end(); ++it) {
+            it->append(from, it->key, object);
+        }
+    }
+};
+
+template<class To>
+struct dynamic_converter<To, typename std::enable_if<dynamic_reflection<To>::enable>::type> {
+    typedef To result_type;
+
+    static
+    result_type
+    convert(const dynamic_t& from) {
+        result_type result;
+
+        detail::dynamic::merge_fields<To>(
+            from.as_object(),
+            [&result](const detail::dynamic::field_t<To>& field, const dynamic_t& value) -> bool {
+                field.load(result, value);
+                return true;
+            }
+        );
+
+        return result;
+    }
+
+    static
+    bool
+    convertible(const dynamic_t& from) {
+        return from.is_object() && detail::dynamic::merge_fields<To>(
+            from.as_object(),
+            [](const detail::dynamic::field_t<To>& field, const dynamic_t& value) -> bool {
+                return field.convertible(value);
+            }
+        );
+    }
+
+    static
+    boost::optional<result_type>
+    try_convert(const dynamic_t& from) {
+        if (!from.is_object()) {
+            return boost::none;
+        }
+
+        result_type result;
+
+        const bool converted = detail::dynamic::merge_fields<To>(
+            from.as_object(),
+            [&result](const detail::dynamic::field_t<To>& field, const dynamic_t& value) -> bool {
+                return field.try_load(result, value);
+            }
+        );
+
+        if (!converted) {
+            return boost::none;
+        }
+
+        return boost::optional<result_type>(std::move(result));
+    }
+};
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_REFLECT_HPP
@@ -0,0 +1,126 @@
+#include "snapshot.hpp"
+
+#include <algorithm>
+
+using namespace cocaine;
+
+namespace {
+
+// Fills the hashes cached inside shared subtrees in advance, otherwise the first readers to hash the document
+// would all compute them.
+void
+freeze(const dynamic_t& value) {
+#ifdef COCAINE_DYNAMIC_CACHED_HASH
+    value.hash();
+#else
+    (void)value;
+#endif
+}
+
+} // namespace
+
+dynamic_snapshot_t::dynamic_snapshot_t(dynamic_t value) :
+    m_current(nullptr),
+    m_epoch(1)
+{
+    freeze(value);
+    m_current.store(new dynamic_t(std::move(value)));
+}
+
+dynamic_snapshot_t::~dynamic_snapshot_t() {
+    for (auto it = m_retired.begin(); it != m_retired.end(); ++it) {
+        delete it->second;
+    }
+
+    delete m_current.load();
+}
+
+void
+dynamic_snapshot_t::publish(dynamic_t value) {
+    freeze(value);
+    const dynamic_t *next = new dynamic_t(std::move(value));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Readers which announce the new epoch have loaded the pointer after the exchange, so they can't see the old version.
+    const dynamic_t *previous = m_current.exchange(next);
+    m_retired.emplace_back(m_epoch.fetch_add(1) + 1, previous);
+
+    reclaim_locked();
+}
+
+size_t
+dynamic_snapshot_t::reclaim() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return reclaim_locked();
+}
+
+size_t
+dynamic_snapshot_t::retired() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_retired.size();
+}
+
+size_t
+dynamic_snapshot_t::reclaim_locked() {
+    if (m_retired.empty()) {
+        return 0;
+    }
+
+    // The oldest epoch a reader may still read in. A reader which has announced its epoch after this scan
+    // loads the pointer after it too, so it gets a version which isn't retired yet.
+    uint64_t oldest = m_epoch.load();
+
+    for (auto it = m_slots.begin(); it != m_slots.end(); ++it) {
+        const uint64_t epoch = it->epoch.load();
+
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+
+    auto alive = std::partition(m_retired.begin(), m_retired.end(), [oldest](const retired_t& version) {
+        return version.first > oldest;
+    });
+
+    for (auto it = alive; it != m_retired.end(); ++it) {
+        delete it->second;
+    }
+
+    const size_t freed = m_retired.end() - alive;
+    m_retired.erase(alive, m_retired.end());
+
+    return freed;
+}
+
+dynamic_snapshot_t::reader_t::reader_t(dynamic_snapshot_t& snapshot) :
+    m_snapshot(snapshot),
+    m_depth(0),
+    m_value(nullptr)
+{
+    std::lock_guard<std::mutex> lock(m_snapshot.m_mutex);
+    m_slot = m_snapshot.m_slots.emplace(m_snapshot.m_slots.end());
+}
+
+dynamic_snapshot_t::reader_t::~reader_t() {
+    std::lock_guard<std::mutex> lock(m_snapshot.m_mutex);
+    m_snapshot.m_slots.erase(m_slot);
+}
+
+dynamic_snapshot_t::guard_t::guard_t(reader_t& reader) :
+    m_reader(reader)
+{
+    if (m_reader.m_depth++ == 0) {
+        // Sequentially consistent, so the announcement is visible to reclaim() before the pointer is loaded.
+        m_reader.m_slot->epoch.store(m_reader.m_snapshot.m_epoch.load());
+        m_reader.m_value = m_reader.m_snapshot.m_current.load();
+    }
+
+    m_value = m_reader.m_value;
+}
+
+dynamic_snapshot_t::guard_t::~guard_t() {
+    if (--m_reader.m_depth == 0) {
+        m_reader.m_slot->epoch.store(0, std::memory_order_release);
+    }
+}
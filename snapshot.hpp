@@ -0,0 +1,141 @@
+#ifndef COCAINE_DYNAMIC_SNAPSHOT_HPP
+#define COCAINE_DYNAMIC_SNAPSHOT_HPP
+
+#include "dynamic.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace cocaine {
+
+// Holder of a document which is replaced by one thread and read by many others, like a reloaded config.
+// Every published version is frozen: it is never modified, so readers share it without copies or locks.
+//
+// Reading is wait-free, it takes a few atomic operations and no locks. Old versions are reclaimed
+// with epochs: every reader announces the epoch it has started reading in, a retired version is freed
+// once all readers which could have seen it are gone. Publishing and reclamation are serialized by a mutex.
+//
+//     dynamic_snapshot_t config(load());
+//
+//     // Once per reading thread.
+//     dynamic_snapshot_t::reader_t reader(config);
+//
+//     // Every time the config is needed.
+//     dynamic_snapshot_t::guard_t guard(reader);
+//     int port = guard->as_object().at("port").to<int>();
+class dynamic_snapshot_t {
+public:
+    class reader_t;
+    class guard_t;
+
+public:
+    explicit
+    dynamic_snapshot_t(dynamic_t value = dynamic_t());
+
+    // All readers must be destroyed before the snapshot.
+    ~dynamic_snapshot_t();
+
+    // Replaces the current version. Readers which already hold the old one keep it until their guards are released,
+    // new guards see the new version. Versions retired earlier and no longer read are freed on the way.
+    void
+    publish(dynamic_t value);
+
+    // Frees retired versions which no reader can see anymore and returns their number.
+    size_t
+    reclaim();
+
+    // Number of retired versions which haven't been freed yet.
+    size_t
+    retired() const;
+
+private:
+    dynamic_snapshot_t(const dynamic_snapshot_t&);
+
+    dynamic_snapshot_t&
+    operator=(const dynamic_snapshot_t&);
+
+    // Epoch announced by a reader, zero while the reader holds no guard.
+    // Padded to a cache line, so readers don't invalidate the lines of each other.
+    struct slot_t {
+        std::atomic<uint64_t> epoch;
+        char padding[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    // Version which is freed once no reader has announced an epoch older than the one it was retired in.
+    typedef std::pair<uint64_t, const dynamic_t*> retired_t;
+
+    size_t
+    reclaim_locked();
+
+private:
+    std::atomic<const dynamic_t*> m_current;
+    std::atomic<uint64_t> m_epoch;
+
+    mutable std::mutex m_mutex;
+    std::list<slot_t> m_slots;
+    std::vector<retired_t> m_retired;
+};
+
+// Registration of a reading thread. Each thread creates its own reader and keeps it for as long as it reads,
+// the registration takes the lock of the snapshot, taking guards doesn't. A reader must not be shared by threads.
+class dynamic_snapshot_t::reader_t {
+public:
+    explicit
+    reader_t(dynamic_snapshot_t& snapshot);
+
+    ~reader_t();
+
+private:
+    reader_t(const reader_t&);
+
+    reader_t&
+    operator=(const reader_t&);
+
+    friend class guard_t;
+
+private:
+    dynamic_snapshot_t& m_snapshot;
+    std::list<slot_t>::iterator m_slot;
+
+    // Nested guards of the reader share the version taken by the outermost one.
+    unsigned int m_depth;
+    const dynamic_t *m_value;
+};
+
+// Pins the current version of the snapshot while alive. The version doesn't change during the lifetime of the guard,
+// even if a newer one is published.
+class dynamic_snapshot_t::guard_t {
+public:
+    explicit
+    guard_t(reader_t& reader);
+
+    ~guard_t();
+
+    const dynamic_t&
+    operator*() const {
+        return *m_value;
+    }
+
+    const dynamic_t*
+    operator->() const {
+        return m_value;
+    }
+
+private:
+    guard_t(const guard_t&);
+
+    guard_t&
+    operator=(const guard_t&);
+
+private:
+    reader_t& m_reader;
+    const dynamic_t *m_value;
+};
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_SNAPSHOT_HPP
@@ -4,83 +4,42 @@
 #include <cocaine/traits.hpp>
 
 #include "dynamic.hpp"
+#include "builder.hpp"
+#include "events.hpp"
+#include "pack.hpp"
 
 namespace cocaine { namespace io {
 
 template<>
 struct type_traits<dynamic_t>
 {
-    template<class Stream>
-    struct pack_visitor :
-        public boost::static_visitor<>
-    {
-        pack_visitor(msgpack::packer<Stream>& packer) :
-            m_packer(packer)
-        {
-            // pass
-        }
-
-        void
-        operator()(const dynamic_t::null_t&) const {
-            m_packer << msgpack::type::nil();
-        }
-
-        void
-        operator()(const dynamic_t::bool_t& v) const {
-            m_packer << v;
-        }
-
-        void
-        operator()(const dynamic_t::int_t& v) const {
-            m_packer << v;
-        }
-
-        void
-        operator()(const dynamic_t::double_t& v) const {
-            m_packer << v;
-        }
-
-        void
-        operator()(const dynamic_t::string_t& v) const {
-            m_packer << v;
-        }
-
-        void
-        operator()(const dynamic_t::array_t& v) const {
-            m_packer.pack_array(v.size());
-
-            for(size_t i = 0; i < v.size(); ++i) {
-                v[i].apply(*this);
-            }
-        }
-
-        void
-        operator()(const dynamic_t::object_t& v) const {
-            m_packer.pack_map(v.size());
-
-            for(auto it = v.begin(); it != v.end(); ++it) {
-                m_packer << it->first;
-                it->second.apply(*this);
-            }
-        }
-
-    private:
-        msgpack::packer<Stream>& m_packer;
-    };
-
     template<class Stream>
     static inline
     void
     pack(msgpack::packer<Stream>& packer, const dynamic_t& source) {
-        source.apply(pack_visitor<Stream>(packer));
+        msgpack_writer_t<Stream> writer(packer);
+        emit(source, writer);
     }
 
     static inline
     void
     unpack(const msgpack::object& object, dynamic_t& target) {
+        // The document is built aside, so the target is left intact if the object turns out to be malformed.
+        dynamic_t result;
+        dynamic_builder_t builder(result);
+
+        emit_object(object, builder);
+
+        target = std::move(result);
+    }
+
+private:
+    static inline
+    void
+    emit_object(const msgpack::object& object, dynamic_builder_t& builder) {
         switch(object.type) {
             case msgpack::type::MAP: {
-                dynamic_t::object_t container;
+                builder.begin_object(object.via.map.size);
 
                 msgpack::object_kv *ptr = object.via.map.ptr,
                                    *const end = ptr + object.via.map.size;
@@ -91,49 +50,48 @@ struct type_traits<dynamic_t>
                         throw msgpack::type_error();
                     }
 
-                    unpack(ptr->val, container[ptr->key.as<std::string>()]);
+                    builder.key(ptr->key.via.raw.ptr, ptr->key.via.raw.size);
+                    emit_object(ptr->val, builder);
                 }
 
-                target = std::move(container);
+                builder.end_object();
             } break;
 
             case msgpack::type::ARRAY: {
-                dynamic_t::array_t container;
-                container.reserve(object.via.array.size);
+                builder.begin_array(object.via.array.size);
 
                 msgpack::object *ptr = object.via.array.ptr,
                                 *const end = ptr + object.via.array.size;
 
-                for(unsigned int index = 0; ptr < end; ++ptr, ++index) {
-                    container.push_back(dynamic_t());
-                    unpack(*ptr, container.back());
+                for(; ptr < end; ++ptr) {
+                    emit_object(*ptr, builder);
                 }
 
-                target = std::move(container);
+                builder.end_array();
             } break;
 
             case msgpack::type::RAW: {
-                target = object.as<std::string>();
+                builder.string_value(object.via.raw.ptr, object.via.raw.size);
             } break;
 
             case msgpack::type::DOUBLE: {
-                target = object.as<double>();
+                builder.double_value(object.as<double>());
             } break;
 
             case msgpack::type::POSITIVE_INTEGER: {
-                target = object.as<uint64_t>();
+                builder.int_value(object.as<uint64_t>());
             } break;
 
             case msgpack::type::NEGATIVE_INTEGER: {
-                target = object.as<int64_t>();
+                builder.int_value(object.as<int64_t>());
             } break;
 
             case msgpack::type::BOOLEAN: {
-                target = object.as<bool>();
+                builder.bool_value(object.as<bool>());
             } break;
 
             case msgpack::type::NIL: {
-                target = dynamic_t::null_t();
+                builder.null_value();
             }
         }
     }
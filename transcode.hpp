@@ -0,0 +1,154 @@
+#ifndef COCAINE_DYNAMIC_TRANSCODE_HPP
+#define COCAINE_DYNAMIC_TRANSCODE_HPP
+
+#include "json.hpp"
+#include "pack.hpp"
+
+#include <vector>
+
+namespace cocaine {
+
+namespace detail { namespace dynamic {
+
+    // Packs events of unknown size into msgpack::sbuffer.
+    // Headers of containers are written as array32/map32 placeholders and patched when the container ends.
+    class msgpack_patcher_t {
+    public:
+        msgpack_patcher_t(msgpack::sbuffer& buffer) :
+            m_buffer(buffer),
+            m_packer(buffer),
+            m_writer(m_packer)
+        {
+            // pass
+        }
+
+        void
+        null_value() {
+            count();
+            m_writer.null_value();
+        }
+
+        void
+        bool_value(dynamic_t::bool_t v) {
+            count();
+            m_writer.bool_value(v);
+        }
+
+        void
+        int_value(dynamic_t::int_t v) {
+            count();
+            m_writer.int_value(v);
+        }
+
+        void
+        double_value(dynamic_t::double_t v) {
+            count();
+            m_writer.double_value(v);
+        }
+
+        void
+        string_value(const char *data, size_t size) {
+            count();
+            m_writer.string_value(data, size);
+        }
+
+        void
+        begin_array(size_t) {
+            begin('\xdd');
+        }
+
+        void
+        end_array() {
+            end();
+        }
+
+        void
+        begin_object(size_t) {
+            begin('\xdf');
+        }
+
+        void
+        key(const char *data, size_t size) {
+            // Map sizes are counted in key-value pairs.
+            ++m_stack.back().size;
+            m_writer.key(data, size);
+        }
+
+        void
+        end_object() {
+            end();
+        }
+
+    private:
+        struct frame_t {
+            size_t offset;
+            bool is_map;
+            uint32_t size;
+        };
+
+        void
+        count() {
+            if (!m_stack.empty() && !m_stack.back().is_map) {
+                ++m_stack.back().size;
+            }
+        }
+
+        void
+        begin(char tag) {
+            count();
+
+            frame_t frame = { m_buffer.size(), tag == '\xdf', 0 };
+            m_stack.push_back(frame);
+
+            const char header[5] = { tag, 0, 0, 0, 0 };
+            m_buffer.write(header, sizeof(header));
+        }
+
+        void
+        end() {
+            const frame_t& frame = m_stack.back();
+            char *header = m_buffer.data() + frame.offset;
+
+            for (size_t i = 0; i < 4; ++i) {
+                header[4 - i] = static_cast<char>(frame.size >> (8 * i));
+            }
+
+            m_stack.pop_back();
+        }
+
+    private:
+        msgpack::sbuffer& m_buffer;
+        msgpack::packer<msgpack::sbuffer> m_packer;
+        io::msgpack_writer_t<msgpack::sbuffer> m_writer;
+
+        std::vector<frame_t> m_stack;
+    };
+
+}} // namespace detail::dynamic
+
+namespace io {
+
+// Converts a msgpack value into JSON text without building a document in memory.
+// Returns the number of msgpack bytes consumed.
+template<class Stream>
+inline
+size_t
+msgpack_to_json(const char *data, size_t size, Stream& stream) {
+    json_writer_t<Stream> writer(stream);
+    return parse_msgpack(data, size, writer);
+}
+
+// Converts JSON text into msgpack without building a document in memory.
+// Returns the number of JSON bytes consumed.
+inline
+size_t
+json_to_msgpack(const char *data, size_t size, msgpack::sbuffer& buffer) {
+    detail::dynamic::msgpack_patcher_t patcher(buffer);
+    return parse_json(data, size, patcher);
+}
+
+} // namespace io
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_TRANSCODE_HPP
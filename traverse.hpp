@@ -0,0 +1,247 @@
+#ifndef COCAINE_DYNAMIC_TRAVERSE_HPP
+#define COCAINE_DYNAMIC_TRAVERSE_HPP
+
+#include "dynamic.hpp"
+#include "path.hpp"
+
+#include <iterator>
+#include <vector>
+
+namespace cocaine {
+
+// Depth-first traversal of a dynamic_t tree driven by an explicit stack instead of recursion,
+// so arbitrarily deep documents don't overflow the call stack and the walk can be cut short.
+//
+// The visitor gets three kinds of events, each along with the traversal which describes the current path:
+//     action_t enter(const dynamic_t& node, const traversal_t& traversal); // before children of a container
+//     action_t leave(const dynamic_t& node, const traversal_t& traversal); // after children of a container
+//     action_t leaf(const dynamic_t& node, const traversal_t& traversal);  // for scalars and strings
+// Returning skip from enter() skips the children and the matching leave(), returning stop from any event
+// ends the traversal. traversal_visitor_t provides default implementations which just proceed.
+class traversal_t {
+public:
+    enum action_t {
+        proceed,
+        skip,
+        stop
+    };
+
+public:
+    // Returns false if the visitor has stopped the traversal.
+    template<class Visitor>
+    bool
+    run(const dynamic_t& root, Visitor& visitor);
+
+    // Number of segments in the path of the current node, zero for the root.
+    size_t
+    depth() const {
+        return m_stack.size();
+    }
+
+    // Whether the level-th segment of the path is an array index or an object key.
+    bool
+    is_index(size_t level) const {
+        return m_stack[level].is_array;
+    }
+
+    size_t
+    index(size_t level) const {
+        return m_stack[level].array_current - m_stack[level].array_begin - 1;
+    }
+
+    const std::string&
+    key(size_t level) const {
+        return std::prev(m_stack[level].object_current)->first;
+    }
+
+    // Path of the current node. Builds the path, so it should be called only when it's actually needed.
+    path_t
+    path() const {
+        path_t result;
+
+        for (size_t level = 0; level < depth(); ++level) {
+            if (is_index(level)) {
+                result.append(index(level));
+            } else {
+                result.append(key(level));
+            }
+        }
+
+        return result;
+    }
+
+private:
+    struct frame_t {
+        const dynamic_t *node;
+
+        // Elements of arrays are walked with pointers, members of objects with iterators.
+        // Both point past the child being visited.
+        bool is_array;
+
+        const dynamic_t *array_begin;
+        const dynamic_t *array_current;
+        const dynamic_t *array_end;
+
+        dynamic_t::object_t::const_iterator object_current;
+        dynamic_t::object_t::const_iterator object_end;
+    };
+
+    enum status_t {
+        visited,
+        // The node has been pushed onto the stack to visit its children.
+        entered,
+        stopped
+    };
+
+    // Reports the node and pushes it onto the stack if its children must be visited.
+    template<class Visitor>
+    status_t
+    visit(const dynamic_t& node, Visitor& visitor);
+
+    // Tells containers from scalars with a single dispatch over the variant.
+    template<class Visitor>
+    struct dispatcher_t :
+        public boost::static_visitor<status_t>
+    {
+        dispatcher_t(traversal_t& traversal, const dynamic_t& node, Visitor& visitor) :
+            m_traversal(traversal),
+            m_node(node),
+            m_visitor(visitor)
+        {
+            // pass
+        }
+
+        template<class T>
+        status_t
+        operator()(const T&) const {
+            return m_visitor.leaf(m_node, m_traversal) == stop ? stopped : visited;
+        }
+
+        status_t
+        operator()(const dynamic_t::array_t& array) const {
+            const action_t action = m_visitor.enter(m_node, m_traversal);
+
+            if (action == proceed) {
+                frame_t frame;
+                frame.node = &m_node;
+                frame.is_array = true;
+                frame.array_begin = array.data();
+                frame.array_current = array.data();
+                frame.array_end = array.data() + array.size();
+                m_traversal.m_stack.push_back(frame);
+            }
+
+            return status(action);
+        }
+
+        status_t
+        operator()(const dynamic_t::object_t& object) const {
+            const action_t action = m_visitor.enter(m_node, m_traversal);
+
+            if (action == proceed) {
+                frame_t frame;
+                frame.node = &m_node;
+                frame.is_array = false;
+                frame.object_current = object.begin();
+                frame.object_end = object.end();
+                m_traversal.m_stack.push_back(frame);
+            }
+
+            return status(action);
+        }
+
+    private:
+        static
+        status_t
+        status(action_t action) {
+            return action == proceed ? entered : action == skip ? visited : stopped;
+        }
+
+    private:
+        traversal_t& m_traversal;
+        const dynamic_t& m_node;
+        Visitor& m_visitor;
+    };
+
+private:
+    std::vector<frame_t> m_stack;
+};
+
+// Base class for traversal visitors which care only about some of the events.
+struct traversal_visitor_t {
+    traversal_t::action_t
+    enter(const dynamic_t&, const traversal_t&) {
+        return traversal_t::proceed;
+    }
+
+    traversal_t::action_t
+    leave(const dynamic_t&, const traversal_t&) {
+        return traversal_t::proceed;
+    }
+
+    traversal_t::action_t
+    leaf(const dynamic_t&, const traversal_t&) {
+        return traversal_t::proceed;
+    }
+};
+
+template<class Visitor>
+bool
+traversal_t::run(const dynamic_t& root, Visitor& visitor) {
+    m_stack.clear();
+
+    if (visit(root, visitor) == stopped) {
+        return false;
+    }
+
+    while (!m_stack.empty()) {
+        frame_t& top = m_stack.back();
+        status_t status = visited;
+
+        // Frames are advanced before their children are visited, so nothing has to be done
+        // with the parent once a child container is left. Siblings are visited in a tight loop
+        // until one of them turns out to be a container which must be entered.
+        if (top.is_array) {
+            while (status == visited && top.array_current != top.array_end) {
+                status = visit(*top.array_current++, visitor);
+            }
+        } else {
+            while (status == visited && top.object_current != top.object_end) {
+                status = visit((top.object_current++)->second, visitor);
+            }
+        }
+
+        if (status == stopped) {
+            return false;
+        } else if (status == entered) {
+            continue;
+        }
+
+        const dynamic_t& node = *top.node;
+        m_stack.pop_back();
+
+        if (visitor.leave(node, *this) == stop) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template<class Visitor>
+traversal_t::status_t
+traversal_t::visit(const dynamic_t& node, Visitor& visitor) {
+    return node.apply(dispatcher_t<Visitor>(*this, node, visitor));
+}
+
+// Convenience wrapper around traversal_t::run().
+template<class Visitor>
+bool
+traverse(const dynamic_t& root, Visitor& visitor) {
+    traversal_t traversal;
+    return traversal.run(root, visitor);
+}
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_TRAVERSE_HPP
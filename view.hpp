@@ -0,0 +1,230 @@
+#ifndef COCAINE_DYNAMIC_VIEW_HPP
+#define COCAINE_DYNAMIC_VIEW_HPP
+
+#include "dynamic.hpp"
+
+#include <boost/iterator/transform_iterator.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace cocaine {
+
+namespace detail { namespace dynamic {
+
+    template<class T>
+    struct convert_element {
+        typedef typename dynamic_converter<T>::result_type result_type;
+
+        result_type
+        operator()(const cocaine::dynamic_t& element) const {
+            return element.to<T>();
+        }
+    };
+
+    template<class T>
+    struct convert_member {
+        typedef std::pair<const std::string&, typename dynamic_converter<T>::result_type> result_type;
+
+        result_type
+        operator()(const cocaine::dynamic_t::object_t::value_type& member) const {
+            return result_type(member.first, member.second.to<T>());
+        }
+    };
+
+}} // namespace detail::dynamic
+
+// Non-owning range over an array converting the elements to T on dereference, see dynamic_t::as_view().
+// Iterators are random access. Dereferencing an element which isn't convertible to T throws like to<T>() does.
+// The view refers to the array and is invalidated by the same operations as its iterators.
+template<class T>
+class array_view_t {
+public:
+    typedef typename dynamic_converter<T>::result_type value_type;
+    typedef boost::transform_iterator<detail::dynamic::convert_element<T>, dynamic_t::array_t::const_iterator>
+            const_iterator;
+
+    static const size_t npos = static_cast<size_t>(-1);
+
+public:
+    explicit
+    array_view_t(const dynamic_t::array_t& array) :
+        m_begin(array.begin()),
+        m_end(array.end())
+    {
+        // pass
+    }
+
+    array_view_t(dynamic_t::array_t::const_iterator begin, dynamic_t::array_t::const_iterator end) :
+        m_begin(begin),
+        m_end(end)
+    {
+        // pass
+    }
+
+    const_iterator
+    begin() const {
+        return const_iterator(m_begin);
+    }
+
+    const_iterator
+    end() const {
+        return const_iterator(m_end);
+    }
+
+    size_t
+    size() const {
+        return m_end - m_begin;
+    }
+
+    bool
+    empty() const {
+        return m_begin == m_end;
+    }
+
+    value_type
+    operator[](size_t index) const {
+        return m_begin[index].template to<T>();
+    }
+
+    value_type
+    front() const {
+        return m_begin->template to<T>();
+    }
+
+    value_type
+    back() const {
+        return (m_end - 1)->template to<T>();
+    }
+
+    // Whether all the elements are convertible to T.
+    bool
+    convertible() const {
+        for (auto it = m_begin; it != m_end; ++it) {
+            if (!it->template convertible_to<T>()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Up to count elements starting at offset, like std::string::substr(). Nothing is copied.
+    // Throws std::out_of_range if the offset is past the end.
+    array_view_t
+    slice(size_t offset, size_t count = npos) const {
+        if (offset > size()) {
+            throw std::out_of_range("slice offset is out of range");
+        }
+
+        const size_t length = std::min(count, size() - offset);
+        return array_view_t(m_begin + offset, m_begin + offset + length);
+    }
+
+private:
+    dynamic_t::array_t::const_iterator m_begin;
+    dynamic_t::array_t::const_iterator m_end;
+};
+
+template<class T>
+const size_t array_view_t<T>::npos;
+
+// Non-owning range over an object in the order of keys. Dereferencing an iterator converts the value
+// and yields std::pair<const std::string&, value_type>.
+template<class T>
+class object_view_t {
+public:
+    typedef typename dynamic_converter<T>::result_type value_type;
+    typedef boost::transform_iterator<detail::dynamic::convert_member<T>, dynamic_t::object_t::const_iterator>
+            const_iterator;
+
+public:
+    explicit
+    object_view_t(const dynamic_t::object_t& object) :
+        m_object(&object)
+    {
+        // pass
+    }
+
+    const_iterator
+    begin() const {
+        return const_iterator(m_object->begin());
+    }
+
+    const_iterator
+    end() const {
+        return const_iterator(m_object->end());
+    }
+
+    size_t
+    size() const {
+        return m_object->size();
+    }
+
+    bool
+    empty() const {
+        return m_object->empty();
+    }
+
+    const_iterator
+    find(const std::string& key) const {
+        return const_iterator(m_object->find(key));
+    }
+
+    // Throws std::out_of_range if there is no such key.
+    value_type
+    at(const std::string& key) const {
+        return m_object->at(key).template to<T>();
+    }
+
+    bool
+    convertible() const {
+        for (auto it = m_object->begin(); it != m_object->end(); ++it) {
+            if (!it->second.template convertible_to<T>()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    const dynamic_t::object_t *m_object;
+};
+
+namespace detail { namespace dynamic {
+
+    template<class T>
+    struct view_of<std::vector<T>> {
+        typedef array_view_t<T> type;
+
+        static
+        type
+        make(const cocaine::dynamic_t& from) {
+            return type(from.as_array());
+        }
+    };
+
+    template<class T>
+    struct view_of<std::map<std::string, T>> {
+        typedef object_view_t<T> type;
+
+        static
+        type
+        make(const cocaine::dynamic_t& from) {
+            return type(from.as_object());
+        }
+    };
+
+}} // namespace detail::dynamic
+
+template<class Container>
+typename detail::dynamic::view_of<Container>::type
+dynamic_t::as_view() const {
+    return detail::dynamic::view_of<Container>::make(*this);
+}
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_VIEW_HPP
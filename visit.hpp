@@ -0,0 +1,154 @@
+#ifndef COCAINE_DYNAMIC_VISIT_HPP
+#define COCAINE_DYNAMIC_VISIT_HPP
+
+#include "dynamic.hpp"
+
+#include <type_traits>
+#include <utility>
+
+namespace cocaine {
+
+namespace detail { namespace dynamic {
+
+    template<class T, bool Const>
+    struct visit_argument {
+        typedef typename std::conditional<Const, const T&, T&>::type type;
+    };
+
+    // Both traits are empty if the function doesn't accept some type, so that the constant and non-constant
+    // versions of dynamic_t::visit() drop out of overload resolution instead of failing it.
+    template<class F, class T, bool Const, class = void>
+    struct visit_call {
+        // pass
+    };
+
+    template<class F, class T, bool Const>
+    struct visit_call<
+        F,
+        T,
+        Const,
+        typename always_void<decltype(std::declval<F&>()(std::declval<typename visit_argument<T, Const>::type>()))>::type
+    > {
+        typedef decltype(std::declval<F&>()(std::declval<typename visit_argument<T, Const>::type>())) type;
+    };
+
+    template<class F, bool Const, class>
+    struct visit_result {
+        // pass
+    };
+
+    template<class F, bool Const>
+    struct visit_result<
+        F,
+        Const,
+        typename always_void<
+            typename visit_call<F, cocaine::dynamic_t::null_t, Const>::type,
+            typename visit_call<F, cocaine::dynamic_t::bool_t, Const>::type,
+            typename visit_call<F, cocaine::dynamic_t::int_t, Const>::type,
+            typename visit_call<F, cocaine::dynamic_t::double_t, Const>::type,
+            typename visit_call<F, cocaine::dynamic_t::string_t, Const>::type,
+            typename visit_call<F, cocaine::dynamic_t::array_t, Const>::type,
+            typename visit_call<F, cocaine::dynamic_t::object_t, Const>::type
+        >::type
+    > {
+        typedef typename std::common_type<
+            typename visit_call<F, cocaine::dynamic_t::null_t, Const>::type,
+            typename visit_call<F, cocaine::dynamic_t::bool_t, Const>::type,
+            typename visit_call<F, cocaine::dynamic_t::int_t, Const>::type,
+            typename visit_call<F, cocaine::dynamic_t::double_t, Const>::type,
+            typename visit_call<F, cocaine::dynamic_t::string_t, Const>::type,
+            typename visit_call<F, cocaine::dynamic_t::array_t, Const>::type,
+            typename visit_call<F, cocaine::dynamic_t::object_t, Const>::type
+        >::type type;
+    };
+
+    template<class Result, class F, class T, bool Const>
+    Result
+    visit_stub(F& f, cocaine::dynamic_t::value_t& value) {
+        // The stub is chosen by the type of the value, so the checked get never fails.
+        return f(static_cast<typename visit_argument<T, Const>::type>(*boost::get<T>(&value)));
+    }
+
+    template<class Result, class F, bool Const>
+    Result
+    visit_value(F& f, cocaine::dynamic_t::value_t& value) {
+        // A dense switch is compiled into a jump table, and unlike a table of function pointers
+        // it lets the compiler inline the overloads into it. Cases are ordered like the alternatives of value_t,
+        // shared subtrees are resolved before the dispatch.
+        switch (value.which()) {
+        case 0:
+            return visit_stub<Result, F, cocaine::dynamic_t::null_t, Const>(f, value);
+        case 1:
+            return visit_stub<Result, F, cocaine::dynamic_t::bool_t, Const>(f, value);
+        case 2:
+            return visit_stub<Result, F, cocaine::dynamic_t::int_t, Const>(f, value);
+        case 3:
+            return visit_stub<Result, F, cocaine::dynamic_t::double_t, Const>(f, value);
+        case 4:
+            return visit_stub<Result, F, cocaine::dynamic_t::string_t, Const>(f, value);
+        case 5:
+            return visit_stub<Result, F, cocaine::dynamic_t::array_t, Const>(f, value);
+        default:
+            return visit_stub<Result, F, cocaine::dynamic_t::object_t, Const>(f, value);
+        }
+    }
+
+}} // namespace detail::dynamic
+
+template<class F>
+typename detail::dynamic::visit_result<F, true>::type
+dynamic_t::visit(F&& f) const {
+    return detail::dynamic::visit_value<typename detail::dynamic::visit_result<F, true>::type, F, true>(f, value());
+}
+
+template<class F>
+typename detail::dynamic::visit_result<F, false>::type
+dynamic_t::visit(F&& f) {
+    detach();
+    return detail::dynamic::visit_value<typename detail::dynamic::visit_result<F, false>::type, F, false>(f, m_value);
+}
+
+// Function object which combines the call operators of several lambdas into one overload set.
+template<class... Functions>
+struct overloaded_t;
+
+template<class Function>
+struct overloaded_t<Function> :
+    public Function
+{
+    overloaded_t(Function function) :
+        Function(std::move(function))
+    {
+        // pass
+    }
+
+    using Function::operator();
+};
+
+template<class Function, class... Rest>
+struct overloaded_t<Function, Rest...> :
+    public Function,
+    public overloaded_t<Rest...>
+{
+    overloaded_t(Function function, Rest... rest) :
+        Function(std::move(function)),
+        overloaded_t<Rest...>(std::move(rest)...)
+    {
+        // pass
+    }
+
+    using Function::operator();
+    using overloaded_t<Rest...>::operator();
+};
+
+// The usual overload resolution applies, so a missing overload for some type is silently replaced
+// with another one the value converts to, like bool_t to int_t.
+template<class... Functions>
+overloaded_t<typename std::decay<Functions>::type...>
+overloaded(Functions&&... functions) {
+    return overloaded_t<typename std::decay<Functions>::type...>(std::forward<Functions>(functions)...);
+}
+
+} // namespace cocaine
+
+#endif // COCAINE_DYNAMIC_VISIT_HPP